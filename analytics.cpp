@@ -0,0 +1,372 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "analytics.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Difficulty metrics of boards (3BV, openings, islands and solver test order).
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "analytics.h"
+#include "driver.h"
+#include "leb128.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <cstdio>
+
+// File-scope definitions. /////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ const char statsMagic[8] = {'M', 'S', 'S', 'T', 'A', 'T', 'S', '1'};
+
+ /*
+  * Metrics of one board, as recorded in the stats file.
+  */
+ class boardRecord
+ {
+  public:
+    unsigned      seed;
+    boardAnalysis a;
+    int           maxTestOrder, n_guesses;
+    int           maxFrontier; // Largest frontier at a guess (not in the stats file).
+    bool          won;
+ };
+
+ /*
+  * Analyse the boards with seeds firstSeed, firstSeed + seedStep, ... (n_boards in all).
+  */
+ template<class Field>
+ void analyseShare
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_boards, const unsigned &firstSeed, const unsigned &seedStep,
+    const bool &solve, std::vector<boardRecord> &records
+ )
+ {
+    Field                        M(n_rows, n_cols, n_mines);
+    basicMineFieldProbMap<Field> P(&M);
+    boardAnalyser                analyser;
+    std::minstd_rand             rng;
+
+    P.setVerbose(false);
+    records.resize(n_boards);
+
+    for (int i = 0; i < n_boards; ++i)
+    {
+       boardRecord &r = records[i];
+
+       r.seed         = firstSeed + i * seedStep;
+       r.maxTestOrder = -1;
+       r.n_guesses    = 0;
+       r.maxFrontier  = 0;
+       r.won          = false;
+
+       M.reset(r.seed);
+       analyser.analyse(M, r.a);
+
+       if (solve)
+       {
+          P.reset();
+          rng.seed(r.seed);
+
+          gameTask task = playAutoGame(M, P);
+          for (task.resume(); not task.done();)
+          {
+             if (task.pendingDecision() == decideGuess)
+             {
+                r.maxFrontier = std::max(r.maxFrontier, int(M.getFrontier().size()));
+             }
+
+             task.resume(chooseSquare(M, P, task.pendingDecision(), rng));
+          }
+
+          r.maxTestOrder = P.getMaxTestOrder();
+          r.n_guesses    = task.getResult().n_guesses;
+          r.won          = task.getResult().won;
+       }
+    }
+ }
+}
+
+// Public function definitions. ////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Three linear passes: count mined neighbours, join squares with none into openings, then
+  * give each numbered square to the openings around it or, failing any, to an island.
+  */
+ template<class Field>
+ void boardAnalyser::analyse(const Field &M, boardAnalysis &a)
+ {
+    const int height = M.getHeight(), width = M.getWidth(), n_squares = height * width;
+
+    count.assign(n_squares, 0);
+    parent.resize(n_squares);
+    size.assign(n_squares, 0);
+
+    a.bbbv = a.n_openings = a.largestOpening = a.openingArea = a.n_islands = 0;
+
+    for (int r = 0; r < height; ++r)
+    {
+       for (int c = 0; c < width; ++c)
+       {
+          if (M.squareHidesMine(square(r, c)))
+          {
+             count[r * width + c] = -1;
+
+             for (int i = std::max(r - 1, 0); i <= std::min(r + 1, height - 1); ++i)
+             {
+                for (int j = std::max(c - 1, 0); j <= std::min(c + 1, width - 1); ++j)
+                {
+                   if (count[i * width + j] >= 0) {++count[i * width + j];}
+                }
+             }
+          }
+       }
+    }
+
+    // Join squares with no mined neighbours to those before them (left and the row above).
+    for (int i = 0; i < n_squares; ++i)
+    {
+       parent[i] = i;
+
+       if (count[i] != 0)
+       {
+          continue;
+       }
+
+       const int r = i / width, c = i % width;
+
+       if (c > 0 and count[i - 1] == 0) {join(i, i - 1);}
+
+       if (r > 0)
+       {
+          for (int j = std::max(c - 1, 0); j <= std::min(c + 1, width - 1); ++j)
+          {
+             if (count[i - width - c + j] == 0) {join(i, i - width - c + j);}
+          }
+       }
+    }
+
+    for (int i = 0; i < n_squares; ++i)
+    {
+       if (count[i] == 0)
+       {
+          const int root = find(i);
+
+          a.n_openings += (root == i);
+          ++size[root];
+          ++a.openingArea;
+       }
+    }
+
+    // Numbered squares.  Islands reuse parent (numbered squares are not in any opening).
+    for (int i = 0; i < n_squares; ++i)
+    {
+       if (count[i] <= 0)
+       {
+          continue;
+       }
+
+       const int r = i / width, c = i % width;
+       int roots[8], n_roots = 0;
+
+       for (int k = std::max(r - 1, 0); k <= std::min(r + 1, height - 1); ++k)
+       {
+          for (int j = std::max(c - 1, 0); j <= std::min(c + 1, width - 1); ++j)
+          {
+             if (count[k * width + j] == 0)
+             {
+                const int root = find(k * width + j);
+
+                if (std::find(roots, roots + n_roots, root) == roots + n_roots)
+                {
+                   roots[n_roots++] = root;
+                   ++size[root];
+                }
+             }
+          }
+       }
+
+       if (n_roots > 0)
+       {
+          ++a.openingArea;
+          count[i] = 9; // Revealed by an opening (counts are not needed again).
+          continue;
+       }
+
+       // Not revealed by any opening: one click, joined to island squares before it.
+       ++a.bbbv;
+
+       for (int k = std::max(r - 1, 0); k <= r; ++k)
+       {
+          for (int j = std::max(c - 1, 0); j <= std::min(c + 1, width - 1); ++j)
+          {
+             const int n = k * width + j;
+
+             if (n < i and 0 < count[n] and count[n] < 9) {join(i, n);}
+          }
+       }
+    }
+
+    for (int i = 0; i < n_squares; ++i)
+    {
+       if (count[i] == 0 and parent[i] == i)
+       {
+          a.largestOpening = std::max(a.largestOpening, size[i]);
+       }
+
+       if (0 < count[i] and count[i] < 9 and find(i) == i)
+       {
+          ++a.n_islands;
+       }
+    }
+
+    a.bbbv += a.n_openings;
+ }
+
+ /*
+  * Thread t analyses seeds firstSeed + t, firstSeed + t + n_threads, ... into its own list
+  * of records, which are interleaved again when written so that the file is in seed order.
+  */
+ bool runAnalytics
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_boards, const unsigned &firstSeed, const int &n_threads,
+    const bool &solve, const char *path, analyticsResult &result
+ )
+ {
+    FILE *file = fopen(path, "wb");
+
+    if (file == 0)
+    {
+       return false;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const int n_shares = std::max(1, std::min(n_threads, n_boards));
+
+    std::vector< std::vector<boardRecord> > records(n_shares);
+    std::vector<std::thread>                threads;
+
+    for (int t = 0; t < n_shares; ++t)
+    {
+       const int n_share = (n_boards - t + n_shares - 1) / n_shares;
+
+       threads.push_back
+       (
+          std::thread
+          (
+             [&, t, n_share]
+             {
+                dispatchFieldType
+                (
+                   n_rows, n_cols,
+                   [&](auto ft)
+                   {
+                      analyseShare<typename decltype(ft)::type>
+                      (
+                         n_rows, n_cols, n_mines, n_share, firstSeed + t, unsigned(n_shares),
+                         solve, records[t]
+                      );
+                   }
+                );
+             }
+          )
+       );
+    }
+
+    for (size_t t = 0; t < threads.size(); ++t)
+    {
+       threads[t].join();
+    }
+
+    // Write the file and total the records.
+    std::vector<unsigned char> buffer(statsMagic, statsMagic + sizeof(statsMagic));
+
+    putNumber(buffer, n_rows);
+    putNumber(buffer, n_cols);
+    putNumber(buffer, n_mines);
+    putNumber(buffer, solve);
+
+    bool written = true;
+
+    for (int i = 0; i < n_boards; ++i)
+    {
+       const boardRecord &r = records[i % n_shares][i / n_shares];
+
+       putNumber(buffer, r.seed);
+       putNumber(buffer, r.a.bbbv);
+       putNumber(buffer, r.a.n_openings);
+       putNumber(buffer, r.a.largestOpening);
+       putNumber(buffer, r.a.openingArea);
+       putNumber(buffer, r.a.n_islands);
+       putNumber(buffer, r.maxTestOrder + 1);
+       putNumber(buffer, r.n_guesses);
+       putNumber(buffer, r.won);
+
+       ++result.n_boards;
+       result.bbbv        += r.a.bbbv;
+       result.n_openings  += r.a.n_openings;
+       result.openingArea += r.a.openingArea;
+       result.n_islands   += r.a.n_islands;
+
+       if (solve)
+       {
+          ++result.n_maxTestOrder[r.maxTestOrder + 1];
+          result.n_won       += r.won;
+          result.n_guesses   += r.n_guesses;
+          result.maxFrontier += r.maxFrontier;
+       }
+
+       if (buffer.size() >= (1 << 16) or i == n_boards - 1)
+       {
+          written = written and fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+          buffer.clear();
+       }
+    }
+
+    if (not buffer.empty())
+    {
+       written = written and fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+    }
+
+    written = (fclose(file) == 0) and written;
+
+    result.seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return written;
+ }
+
+} // End namespace minesweeper.
+
+// Explicit instantiations. ////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ template void boardAnalyser::analyse(const mineField &, boardAnalysis &);
+ template void boardAnalyser::analyse(const mineFieldT< 8,  8> &, boardAnalysis &);
+ template void boardAnalyser::analyse(const mineFieldT<16, 16> &, boardAnalysis &);
+ template void boardAnalyser::analyse(const mineFieldT<16, 30> &, boardAnalysis &);
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,134 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "analytics.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Difficulty metrics of boards (3BV, openings, islands and solver test order).
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "minefield.h"
+
+#include <vector>
+
+// Stats file format. //////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * A stats file is the 8 byte magic number "MSSTATS1", then the number of rows, columns and
+  * mines, and 1 if the boards were solved or 0 if not, then one record per board in order of
+  * seed.  Each record is the numbers
+  *
+  *    seed  3BV  openings  largestOpening  openingArea  islands  maxTestOrder + 1  guesses  won
+  *
+  * (the last three 0 if the boards were not solved), each unsigned LEB128 as in trace files.
+  */
+
+ // Class definitions. //////////////////////////////////////////////////////////////////////////
+
+ /*
+  * Metrics of the mine layout of a board.  An opening is a region of squares with no mined
+  * neighbours (joined through corners) together with the numbered squares around it, all of
+  * which one click reveals.  An island is a group of touching numbered squares not revealed
+  * by any opening.
+  */
+ class boardAnalysis
+ {
+  public:
+    int bbbv;           // 3BV: the least clicks that solve the board (openings + numbered
+                        // squares not revealed by openings).
+    int n_openings;
+    int largestOpening; // Squares revealed by the largest opening.
+    int openingArea;    // Squares revealed by openings (each counted once).
+    int n_islands;
+ };
+
+ /*
+  * Finds the boardAnalysis of boards, labelling regions with a union-find over the squares.
+  * The working arrays are kept between boards of the same size.
+  */
+ class boardAnalyser
+ {
+  public:
+    /* Analyse the hidden mine layout of M (uses squareHidesMine()). */
+    template<class Field>
+    void analyse(const Field &M, boardAnalysis &a);
+
+    /*
+     * After analyse(), return the number of squares a click on square i (row * width + col)
+     * reveals: 0 if it is mined, 1 if numbered, or the size of its opening.
+     */
+    int squaresRevealed(const int &i)
+    {return (count[i] < 0)? 0: (count[i] > 0)? 1: size[find(i)];}
+
+    /* After analyse(), test whether square i is in an opening (has no mined neighbours). */
+    bool inOpening(const int &i) const {return count[i] == 0;}
+
+  private:
+    int find(int i)
+    {
+       while (parent[i] != i) {parent[i] = parent[parent[i]]; i = parent[i];}
+       return i;
+    }
+
+    void join(const int &i, const int &j) {parent[find(i)] = find(j);}
+
+    std::vector<int> count;  // Mined neighbours of each square (-1 if mined).
+    std::vector<int> parent; // Union-find forest over openings and over islands.
+    std::vector<int> size;   // Squares revealed by the opening with root i.
+ };
+
+ /*
+  * Totals for runAnalytics().
+  */
+ class analyticsResult
+ {
+  public:
+    analyticsResult(void)
+    : n_boards(0), bbbv(0), n_openings(0), openingArea(0), n_islands(0),
+      n_won(0), n_guesses(0), maxFrontier(0), seconds(0.0)
+    {
+       for (int i = 0; i < 5; ++i) {n_maxTestOrder[i] = 0;}
+    }
+
+    long   n_boards;
+    long   bbbv, n_openings, openingArea, n_islands;
+    long   n_maxTestOrder[5]; // Boards by maxTestOrder + 1 (solved boards only).
+    long   n_won, n_guesses;
+    long   maxFrontier; // Sum over solved boards of the largest frontier at a guess.
+    double seconds;
+ };
+
+ // Function declarations. //////////////////////////////////////////////////////////////////////
+
+ /*
+  * Analyse the boards with seeds firstSeed to firstSeed + n_boards - 1, split between
+  * n_threads threads, and write their records to the stats file at path.  If solve is true,
+  * each board is also played by the automated solver (as in --batch, with the same results),
+  * recording the highest order of test it needed (see getMaxTestOrder() in "mineprob.h").
+  * Return false if the file could not be written.
+  */
+ bool runAnalytics
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_boards, const unsigned &firstSeed, const int &n_threads,
+    const bool &solve, const char *path, analyticsResult &result
+ );
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,180 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "arena.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Per-thread bump allocator for the solver's temporary data.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <cstddef>
+
+// Class definitions. //////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Memory handed out by bumping an offset through a list of blocks, and taken back only by
+  * rewinding to an earlier mark.  When the outermost scratchScope ends, the blocks are
+  * merged into one large enough for everything used so far, so that once a thread has seen
+  * its largest update it allocates nothing more from the heap.  Blocks of more than
+  * maxRetained bytes in all are freed instead, so that a thread does not hold the working
+  * data of an exceptionally large update for the rest of its life (the heap allocations of
+  * updates that large cost little beside the updates themselves).
+  */
+ class scratchArena
+ {
+  public:
+    enum {initialSize = 1 << 16, maxRetained = 1 << 24};
+
+    class mark
+    {
+     public:
+       std::size_t block, used;
+    };
+
+    scratchArena(void) : current(0), used(0), depth(0) {}
+
+    void *allocate(const std::size_t &n, const std::size_t &align)
+    {
+       for (;;)
+       {
+          if (current < blocks.size())
+          {
+             const std::size_t p = (used + align - 1) & ~(align - 1);
+
+             if (p + n <= blocks[current].size)
+             {
+                used = p + n;
+                return blocks[current].data.get() + p;
+             }
+
+             ++current;
+             used = 0;
+          }
+          else
+          {
+             const std::size_t last = blocks.empty()? initialSize / 2: blocks.back().size;
+
+             blocks.push_back(block(std::max(n + align, 2 * last)));
+          }
+       }
+    }
+
+    mark getMark(void) const {mark m; m.block = current; m.used = used; return m;}
+
+    /* Return the bytes held by the arena (used or not). */
+    std::size_t capacity(void) const
+    {
+       std::size_t total = 0;
+       for (const block &b: blocks) {total += b.size;}
+       return total;
+    }
+
+    void enter(void) {++depth;}
+
+    /* Release everything allocated since m was taken. */
+    void leave(const mark &m)
+    {
+       current = m.block;
+       used    = m.used;
+
+       if (--depth == 0 and current == 0 and used == 0)
+       {
+          const std::size_t total = capacity();
+
+          if (total > maxRetained)
+          {
+             blocks.clear();
+          }
+          else if (blocks.size() > 1)
+          {
+             blocks.clear();
+             blocks.push_back(block(total));
+          }
+       }
+    }
+
+  private:
+    class block
+    {
+     public:
+       explicit block(const std::size_t &_size) : data(new char[_size]), size(_size) {}
+
+       std::unique_ptr<char[]> data; // (Aligned for any type, as by operator new[].)
+       std::size_t             size;
+    };
+
+    std::vector<block> blocks;
+    std::size_t        current, used; // Block in use, and bytes used in it.
+    int                depth;         // Number of scratchScopes open.
+ };
+
+ /* Return the arena of the calling thread. */
+ inline scratchArena &threadScratch(void)
+ {
+    thread_local scratchArena arena;
+    return arena;
+ }
+
+ /*
+  * Releases everything allocated from the thread's arena during its lifetime when it ends.
+  * Scopes nest.  Scratch containers must not outlive the scope they were filled in.
+  */
+ class scratchScope
+ {
+  public:
+    scratchScope(void) : arena(threadScratch()), m(arena.getMark()) {arena.enter();}
+    ~scratchScope(void) {arena.leave(m);}
+
+    scratchScope(const scratchScope &) = delete;
+    scratchScope &operator=(const scratchScope &) = delete;
+
+  private:
+    scratchArena      &arena;
+    scratchArena::mark m;
+ };
+
+ /*
+  * Standard allocator taking memory from the calling thread's arena.  Deallocation does
+  * nothing: memory is reclaimed when the enclosing scratchScope ends.
+  */
+ template<class T>
+ class scratchAllocator
+ {
+  public:
+    typedef T value_type;
+
+    scratchAllocator(void) {}
+    template<class U> scratchAllocator(const scratchAllocator<U> &) {}
+
+    T *allocate(std::size_t n)
+    {return static_cast<T *>(threadScratch().allocate(n * sizeof(T), alignof(T)));}
+
+    void deallocate(T *, std::size_t) {}
+
+    template<class U> bool operator==(const scratchAllocator<U> &) const {return true;}
+ };
+
+ template<class T> using scratchVector = std::vector< T, scratchAllocator<T> >;
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,419 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "bitboard.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Function definitions for class "bitboardBatch".
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "bitboard.h"
+
+#include <algorithm>
+
+#include <cassert>
+#include <cstdlib>
+
+// File-scope inline function definitions. /////////////////////////////////////////////////////////
+
+namespace
+{
+
+ inline int popcount(const uint64_t &m) {return __builtin_popcountll(m);}
+
+ /*
+  * Add bit mask b to the 4 bit counters held as bit planes p0 (least significant) to p3.
+  */
+ inline void addToPlanes(uint64_t &p0, uint64_t &p1, uint64_t &p2, uint64_t &p3, uint64_t b)
+ {
+    uint64_t carry;
+    carry = p0 & b; p0 ^= b;
+    b = carry; carry = p1 & b; p1 ^= b;
+    b = carry; carry = p2 & b; p2 ^= b;
+    p3 ^= carry;
+ }
+
+ const int dirRow[8] = {-1, -1, -1,  0, 0,  1, 1, 1};
+ const int dirCol[8] = {-1,  0,  1, -1, 1, -1, 0, 1};
+
+}
+
+// Public function definitions. ////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Constructor.
+  */
+ bitboardBatch::bitboardBatch(const int &_n_rows, const int &_n_cols, const int &_n_mines)
+ : n_rows(_n_rows), n_cols(_n_cols), n_cells(_n_rows * _n_cols), n_mines(_n_mines)
+ {
+    assert(fits(n_rows, n_cols));
+    assert(n_mines < n_cells);
+
+    boardMask = (n_cells == 64)? ~uint64_t(0): (uint64_t(1) << n_cells) - 1;
+
+    leftCol = rightCol = 0;
+    for (int r = 0; r < n_rows; ++r)
+    {
+       leftCol  |= uint64_t(1) << (r * n_cols);
+       rightCol |= uint64_t(1) << (r * n_cols + n_cols - 1);
+    }
+
+    for (int i = 0; i < n_cells; ++i)
+    {
+       const int r = i / n_cols, c = i % n_cols;
+
+       nbourMask[i] = nearMask[i] = 0;
+
+       for (int nr = r - 2; nr <= r + 2; ++nr)
+       {
+          for (int nc = c - 2; nc <= c + 2; ++nc)
+          {
+             if (0 <= nr and nr < n_rows and 0 <= nc and nc < n_cols and (nr != r or nc != c))
+             {
+                const uint64_t bit = uint64_t(1) << (nr * n_cols + nc);
+
+                nearMask[i] |= bit;
+
+                if (std::abs(nr - r) <= 1 and std::abs(nc - c) <= 1)
+                {
+                   nbourMask[i] |= bit;
+                }
+             }
+          }
+       }
+    }
+
+    for (int l = 0; l < n_lanes; ++l)
+    {
+       active[l] = false;
+    }
+ }
+
+ /*
+  * Fill idle lanes with new games, then advance every lane in lockstep: reveal, deduce
+  * until nothing more can be deduced, then finish or guess.
+  */
+ void bitboardBatch::run
+ (
+    const unsigned &firstSeed, const unsigned &seedStep, const int &n_games,
+    long &n_won, long &n_guesses
+ )
+ {
+    int n_started = 0;
+
+    for (;;)
+    {
+       bool anyActive = false, anyStarted = false;
+
+       for (int l = 0; l < n_lanes; ++l)
+       {
+          if (not active[l] and n_started < n_games)
+          {
+             startGame(l, firstSeed + n_started * seedStep);
+             ++n_started;
+             anyStarted = true;
+          }
+
+          anyActive = anyActive or active[l];
+       }
+
+       if (not anyActive)
+       {
+          break;
+       }
+
+       if (anyStarted)
+       {
+          countNbours();
+       }
+
+       bool progress;
+       do
+       {
+          revealPending();
+          progress = applySimpleTests();
+
+          for (int l = 0; l < n_lanes and not progress; ++l)
+          {
+             progress = applyPairTests(l);
+          }
+       }
+       while (progress);
+
+       for (int l = 0; l < n_lanes; ++l)
+       {
+          if (not active[l])
+          {
+             continue;
+          }
+
+          const bool won = (not lost[l] and explored[l] == (boardMask & ~mines[l]));
+
+          if (lost[l] or won)
+          {
+             n_won     += won;
+             n_guesses += n_guessesMade[l];
+
+             // Idle lanes have no unknown squares, so the lockstep steps do nothing for them.
+             active[l]   = false;
+             mines[l]    = explored[l] = pending[l] = 0;
+             flagged[l]  = boardMask;
+          }
+          else
+          {
+             guess(l);
+          }
+       }
+    }
+ }
+
+} // End namespace minesweeper.
+
+// Private function definitions. ///////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Lay mines exactly as basicMineField::reset(seed) does, and click the centre square.
+  */
+ void bitboardBatch::startGame(const int &l, const unsigned &seed)
+ {
+    layRng[l].seed(seed);
+    guessRng[l].seed(seed);
+
+    mines[l] = 0;
+    for (int n = 0; n < n_mines; ++n)
+    {
+       for (;;)
+       {
+          const int r = layRng[l]() % n_rows;
+          const int c = layRng[l]() % n_cols;
+          const uint64_t bit = uint64_t(1) << (r * n_cols + c);
+
+          if (not (mines[l] & bit))
+          {
+             mines[l] |= bit;
+             break;
+          }
+       }
+    }
+
+    explored[l]      = flagged[l] = 0;
+    pending[l]       = uint64_t(1) << ((n_rows / 2) * n_cols + n_cols / 2);
+    active[l]        = true;
+    lost[l]          = false;
+    n_guessesMade[l] = 0;
+ }
+
+ /*
+  * Return m with every bit moved dr rows and dc columns (bits moved off the board are lost).
+  * On boards of one row the amount may reach 64 or more, where every bit is moved off the
+  * board (and shifting a uint64_t by that much would be undefined).
+  */
+ uint64_t bitboardBatch::shift(const uint64_t &m, const int &dr, const int &dc) const
+ {
+    const uint64_t src    = m & ~(dc > 0? rightCol: 0) & ~(dc < 0? leftCol: 0);
+    const int      amount = dr * n_cols + dc;
+
+    if (amount >= 64 or amount <= -64)
+    {
+       return 0;
+    }
+
+    return (amount >= 0? src << amount: src >> -amount) & boardMask;
+ }
+
+ /*
+  * Compute the number of mined neighbours of every square, as bit planes, for all lanes.
+  */
+ void bitboardBatch::countNbours(void)
+ {
+    for (int l = 0; l < n_lanes; ++l)
+    {
+       uint64_t p0 = 0, p1 = 0, p2 = 0, p3 = 0;
+
+       for (int d = 0; d < 8; ++d)
+       {
+          addToPlanes(p0, p1, p2, p3, shift(mines[l], dirRow[d], dirCol[d]));
+       }
+
+       plane[0][l] = p0; plane[1][l] = p1; plane[2][l] = p2; plane[3][l] = p3;
+    }
+ }
+
+ /*
+  * Explore the pending squares of all lanes, flooding out from squares with no mined
+  * neighbours one ring per iteration.  A lane that explores a mine is lost.
+  */
+ void bitboardBatch::revealPending(void)
+ {
+    uint64_t front[n_lanes];
+
+    for (int l = 0; l < n_lanes; ++l)
+    {
+       front[l]   = pending[l] & ~explored[l] & ~flagged[l];
+       lost[l]    = lost[l] or (front[l] & mines[l]);
+       front[l]  &= ~mines[l];
+       pending[l] = 0;
+    }
+
+    bool any;
+    do
+    {
+       any = false;
+
+       for (int l = 0; l < n_lanes; ++l)
+       {
+          explored[l] |= front[l];
+
+          const uint64_t zeros =
+          front[l] & ~(plane[0][l] | plane[1][l] | plane[2][l] | plane[3][l]);
+
+          uint64_t grown = zeros;
+          for (int d = 0; d < 8; ++d)
+          {
+             grown |= shift(zeros, dirRow[d], dirCol[d]);
+          }
+
+          front[l] = grown & ~explored[l] & ~flagged[l];
+          any      = any or front[l];
+       }
+    }
+    while (any);
+ }
+
+ /*
+  * Apply the simple tests (see basicMineFieldProbMap::applySimpleTests()) to every explored
+  * square of every lane.  Squares found clear become pending, squares found mined are flagged.
+  * Return true if anything was learned.
+  */
+ bool bitboardBatch::applySimpleTests(void)
+ {
+    uint64_t newClear[n_lanes], newMined[n_lanes];
+
+    for (int l = 0; l < n_lanes; ++l)
+    {
+       newClear[l] = newMined[l] = 0;
+    }
+
+    for (int i = 0; i < n_cells; ++i)
+    {
+       for (int l = 0; l < n_lanes; ++l)
+       {
+          const uint64_t exploredMask = 0 - (explored[l] >> i & 1); // All ones if explored.
+          const uint64_t unk          = nbourMask[i] & unknown(l) & exploredMask;
+
+          const int n_unk      = popcount(unk);
+          const int n_unkMined = count(l, i) - popcount(nbourMask[i] & flagged[l]);
+
+          newClear[l] |= (n_unkMined == 0    )? unk: 0;
+          newMined[l] |= (n_unkMined == n_unk)? unk: 0;
+       }
+    }
+
+    bool learned = false;
+
+    for (int l = 0; l < n_lanes; ++l)
+    {
+       flagged[l] |= newMined[l];
+       pending[l] |= newClear[l];
+       learned     = learned or newClear[l] or newMined[l];
+    }
+
+    return learned;
+ }
+
+ /*
+  * Apply the tests involving one other square (see basicMineFieldProbMap::applyComplexTests()
+  * and updateUnkNbsShared()) to every pair of explored squares of lane l that share unknown
+  * neighbours.  Return true if anything was learned.
+  */
+ bool bitboardBatch::applyPairTests(const int &l)
+ {
+    const uint64_t unk = unknown(l);
+
+    uint64_t newClear = 0, newMined = 0;
+
+    for (uint64_t S = explored[l]; S; S &= S - 1)
+    {
+       const int      s    = __builtin_ctzll(S);
+       const uint64_t unkS = nbourMask[s] & unk;
+
+       if (not unkS)
+       {
+          continue;
+       }
+
+       const int n_unkMinedS = count(l, s) - popcount(nbourMask[s] & flagged[l]);
+
+       for (uint64_t N = nearMask[s] & explored[l]; N; N &= N - 1)
+       {
+          const int      n      = __builtin_ctzll(N);
+          const uint64_t unkN   = nbourMask[n] & unk;
+          const uint64_t shared = unkS & unkN;
+
+          if (not shared)
+          {
+             continue;
+          }
+
+          const int n_unkMinedN   = count(l, n) - popcount(nbourMask[n] & flagged[l]);
+          const int n_shared      = popcount(shared);
+          const int n_sNotShared  = popcount(unkS) - n_shared;
+          const int n_nNotShared  = popcount(unkN) - n_shared;
+
+          if (n_sNotShared == 0)
+          {
+             continue;
+          }
+
+          const int minShared = std::max
+          (
+             std::max(0, n_unkMinedS - n_sNotShared), n_unkMinedN - n_nNotShared
+          );
+          const int maxShared = std::min(std::min(n_shared, n_unkMinedS), n_unkMinedN);
+
+          if (n_unkMinedS - maxShared == n_sNotShared) {newMined |= unkS & ~shared;}
+          if (n_unkMinedS - minShared == 0           ) {newClear |= unkS & ~shared;}
+       }
+    }
+
+    flagged[l] |= newMined;
+    pending[l] |= newClear;
+
+    return newClear or newMined;
+ }
+
+ /*
+  * Explore a square chosen as chooseSquare() does: uniformly at random among squares
+  * that are unexplored and not known to be mined, in row major order.
+  */
+ void bitboardBatch::guess(const int &l)
+ {
+    uint64_t unk = unknown(l);
+
+    assert(unk != 0);
+
+    for (int n = guessRng[l]() % popcount(unk); n > 0; --n)
+    {
+       unk &= unk - 1;
+    }
+
+    pending[l] = unk & (0 - unk); // Lowest remaining bit.
+    ++n_guessesMade[l];
+ }
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
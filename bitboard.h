@@ -0,0 +1,110 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "bitboard.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Class "bitboardBatch" definition.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "driver.h"
+
+#include <random>
+
+#include <stdint.h>
+
+// Class definition. ///////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Plays up to n_lanes automated games at once on boards of at most 64 squares, each board
+  * held as 64 bit masks (bit r * width + c for square (r, c)).  Neighbour counting, revealing
+  * and the simple tests are run for all lanes in lockstep, with lanes that have nothing to
+  * do masked out, so that the loops over lanes can be vectorised.
+  *
+  * Games are played as by gameScheduler, with the same mine layouts and decision policy
+  * (see chooseSquare()).  Deductions use the simple tests and the tests involving one other
+  * square from basicMineFieldProbMap, but not those involving two or three other squares.
+  */
+ class bitboardBatch
+ {
+  public:
+    enum {n_lanes = 32};
+
+    /* Test whether boards of these dimensions fit in a bitboard. */
+    static bool fits(const int &n_rows, const int &n_cols)
+    {return n_rows > 0 and n_cols > 0 and n_rows * n_cols <= 64;}
+
+    /* Constructor.  Dimensions must fit. */
+    bitboardBatch(const int &n_rows, const int &n_cols, const int &n_mines);
+
+    /*
+     * Play the games with seeds firstSeed, firstSeed + seedStep, ... (n_games in all),
+     * adding results to n_won and n_guesses.
+     */
+    void run
+    (
+       const unsigned &firstSeed, const unsigned &seedStep, const int &n_games,
+       long &n_won, long &n_guesses
+    );
+
+  private:
+    // Private function declarations. //////////////////////////////////////////////////////////
+
+    void startGame(const int &l, const unsigned &seed);
+
+    /* Lockstep steps (all lanes). */
+    void countNbours(void);
+    void revealPending(void);
+    bool applySimpleTests(void);
+
+    /* Per lane steps. */
+    bool applyPairTests(const int &l);
+    void guess(const int &l);
+
+    uint64_t unknown(const int &l) const {return boardMask & ~explored[l] & ~flagged[l];}
+
+    int count(const int &l, const int &i) const
+    {
+       return int(plane[0][l] >> i & 1)      | int(plane[1][l] >> i & 1) << 1 |
+              int(plane[2][l] >> i & 1) << 2 | int(plane[3][l] >> i & 1) << 3;
+    }
+
+    uint64_t shift(const uint64_t &m, const int &dr, const int &dc) const;
+
+    // Private constants & variables. //////////////////////////////////////////////////////////
+
+    const int n_rows, n_cols, n_cells, n_mines;
+
+    uint64_t boardMask;
+    uint64_t leftCol, rightCol;     // Squares in column 0 and column n_cols - 1.
+    uint64_t nbourMask[64];         // Neighbours of each square.
+    uint64_t nearMask[64];          // Squares within two rows and columns of each square
+                                    // (those that may share neighbours with it).
+
+    // Per lane state (structure of arrays).
+    uint64_t mines[n_lanes], explored[n_lanes], flagged[n_lanes], pending[n_lanes];
+    uint64_t plane[4][n_lanes];     // Bit planes of the number of mined neighbours.
+    bool     active[n_lanes], lost[n_lanes];
+    int      n_guessesMade[n_lanes];
+
+    std::minstd_rand layRng[n_lanes], guessRng[n_lanes];
+ };
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
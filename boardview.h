@@ -0,0 +1,141 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "boardview.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Class "boardView" definition.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef BOARDVIEW_H
+#define BOARDVIEW_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "minefield.h"
+
+#include <vector>
+
+#include <cassert>
+
+// Global class definitions. ///////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Read-only view of the visible state of a minefield held in a caller-owned buffer of one
+  * byte per square (row major).  The hidden mine map is not known, so a boardView can be
+  * given to a basicMineFieldProbMap but cannot be explored.
+  *
+  * Cell values are those of the C API in "libminesweeper.h":
+  *   [0 - 8] If explored, meaning that many mines lie in surrounding squares.
+  *   cellUnknown If unexplored.
+  *   cellFlagged If flagged (treated as unexplored by the solver).
+  */
+ class boardView
+ {
+  public:
+    typedef dynamicDims dimsType;
+
+    enum {cellUnknown = 0xff, cellFlagged = 0xfe};
+
+    /* Constructor. */
+    boardView(const int &h, const int &w, const unsigned char *_cells = 0)
+    : height(h), width(w), cells(0), frontierVersion(0)
+    {
+       frontier.reserve(std::size_t(h) * std::size_t(w));
+       setCells(_cells);
+    }
+
+    /* Point the view at a different buffer (of the same dimensions). */
+    void setCells(const unsigned char *_cells)
+    {
+       cells = _cells;
+       findFrontier();
+    }
+
+    /** Get functions. **/
+    int getHeight(void) const {return height;}
+    int getWidth(void)  const {return width;}
+
+    /* As basicMineField::getFrontier() (found by scanning the buffer in setCells()). */
+    const std::vector<square> &getFrontier(void) const {return frontier;}
+    unsigned getFrontierVersion(void) const {return frontierVersion;}
+
+    /** Boolean test functions. **/
+
+    /* Test whether square is inside map. */
+    bool squareInsideMap(const int &r, const int &c) const
+    {return (0 <= r && r < getHeight() && 0 <= c && c < getWidth());}
+    bool squareInsideMap(const square &s) const {return squareInsideMap(s.row, s.col);}
+
+    /* Test whether square has been flagged. */
+    bool squareFlagged(const int &r, const int &c) const
+    {assert(squareInsideMap(r, c)); return cell(r, c) == cellFlagged;}
+    bool squareFlagged(const square &s) const {return squareFlagged(s.row, s.col);}
+
+    /* Test whether square has been explored. */
+    bool squareExplored(const int &r, const int &c) const
+    {assert(squareInsideMap(r, c)); return cell(r, c) <= 8;}
+    bool squareExplored(const square &s) const {return squareExplored(s.row, s.col);}
+
+    /** Counting functions. **/
+
+    /* Returns the number of mines surrounding that square (use only if square explored). */
+    int n_minedNbours(const int &r, const int &c) const
+    {assert(squareExplored(r, c)); return cell(r, c);}
+    int n_minedNbours(const square &s) const {return n_minedNbours(s.row, s.col);}
+
+  private:
+
+    unsigned char cell(const int &r, const int &c) const {return cells[r * width + c];}
+
+    void findFrontier(void)
+    {
+       frontier.clear();
+       ++frontierVersion;
+
+       for (int r = 0; cells != 0 and r < height; ++r)
+       {
+          for (int c = 0; c < width; ++c)
+          {
+             if (not squareExplored(r, c))
+             {
+                continue;
+             }
+
+             bool unexploredNbour = false;
+
+             for (int i = std::max(r - 1, 0); i <= std::min(r + 1, height - 1); ++i)
+             {
+                for (int j = std::max(c - 1, 0); j <= std::min(c + 1, width - 1); ++j)
+                {
+                   unexploredNbour = unexploredNbour or not squareExplored(i, j);
+                }
+             }
+
+             if (unexploredNbour) {frontier.push_back(square(r, c));}
+          }
+       }
+    }
+
+    const int height, width;
+
+    const unsigned char *cells; // Caller-owned, height * width bytes.
+
+    std::vector<square> frontier;        // (Room for every square is reserved so that
+                                         //  setCells() does no heap allocation.)
+    unsigned            frontierVersion;
+ };
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
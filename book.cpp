@@ -0,0 +1,280 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "book.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Opening books of first click outcomes per board size and number of mines.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "book.h"
+#include "analytics.h"
+#include "leb128.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <cstdio>
+#include <cstring>
+
+// File-scope definitions. /////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ const char bookMagic[8] = {'M', 'S', 'B', 'O', 'O', 'K', '0', '1'};
+
+ /*
+  * Tally the first click outcomes of every square over the boards with seeds firstSeed,
+  * firstSeed + seedStep, ... (n_boards in all).
+  */
+ template<class Field>
+ void simulateShare
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_boards, const unsigned &firstSeed, const unsigned &seedStep,
+    std::vector<unsigned long long> &n_openings, std::vector<unsigned long long> &n_revealed
+ )
+ {
+    Field         M(n_rows, n_cols, n_mines);
+    boardAnalyser analyser;
+    boardAnalysis a;
+
+    n_openings.assign(n_rows * n_cols, 0);
+    n_revealed.assign(n_rows * n_cols, 0);
+
+    for (int b = 0; b < n_boards; ++b)
+    {
+       M.reset(firstSeed + b * seedStep);
+       analyser.analyse(M, a);
+
+       for (int i = 0; i < n_rows * n_cols; ++i)
+       {
+          n_openings[i] += analyser.inOpening(i);
+          n_revealed[i] += analyser.squaresRevealed(i);
+       }
+    }
+ }
+}
+
+// Public function definitions. ////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ bool openingBook::load
+ (
+    const char *path, const int &_n_rows, const int &_n_cols, const int &_n_mines
+ )
+ {
+    FILE *file = fopen(path, "rb");
+
+    if (file == 0)
+    {
+       return false;
+    }
+
+    std::vector<unsigned char> data;
+    unsigned char              block[1 << 16];
+    size_t                     n;
+
+    while ((n = fread(block, 1, sizeof(block), file)) > 0)
+    {
+       data.insert(data.end(), block, block + n);
+    }
+
+    fclose(file);
+
+    if (data.size() < sizeof(bookMagic) or memcmp(&data[0], bookMagic, sizeof(bookMagic)))
+    {
+       return false;
+    }
+
+    bool   found = false;
+    size_t pos   = sizeof(bookMagic);
+
+    while (pos < data.size())
+    {
+       unsigned long long rows, cols, mines, boards;
+
+       if
+       (
+          not getNumber(data, pos, rows)  or not getNumber(data, pos, cols) or
+          not getNumber(data, pos, mines) or not getNumber(data, pos, boards) or
+          2 * rows * cols > data.size() - pos // At least two bytes per square follow.
+       )
+       {
+          return false;
+       }
+
+       const bool match =
+       (int(rows) == _n_rows and int(cols) == _n_cols and int(mines) == _n_mines);
+
+       if (match)
+       {
+          n_rows = rows; n_cols = cols; n_mines = mines; n_boards = boards;
+          n_openings.resize(rows * cols);
+          n_revealed.resize(rows * cols);
+          found = (boards > 0);
+       }
+
+       for (unsigned long long i = 0; i < rows * cols; ++i)
+       {
+          unsigned long long o, r;
+
+          if (not getNumber(data, pos, o) or not getNumber(data, pos, r))
+          {
+             return false;
+          }
+
+          if (match) {n_openings[i] = o; n_revealed[i] = r;}
+       }
+    }
+
+    if (found)
+    {
+       findBest();
+    }
+
+    return found;
+ }
+
+ /*
+  *
+  */
+ bool openingBook::build
+ (
+    const char *path, const int &_n_rows, const int &_n_cols, const int &_n_mines,
+    const int &_n_boards, const unsigned &firstSeed, const int &n_threads
+ )
+ {
+    n_rows = _n_rows; n_cols = _n_cols; n_mines = _n_mines; n_boards = _n_boards;
+
+    // Thread t simulates seeds firstSeed + t, firstSeed + t + n_threads, ...
+    const int n_shares = std::max(1, std::min(n_threads, n_boards));
+
+    std::vector< std::vector<unsigned long long> > openings(n_shares), revealed(n_shares);
+    std::vector<std::thread>                       threads;
+
+    for (int t = 0; t < n_shares; ++t)
+    {
+       const int n_share = (n_boards - t + n_shares - 1) / n_shares;
+
+       threads.push_back
+       (
+          std::thread
+          (
+             [&, t, n_share]
+             {
+                dispatchFieldType
+                (
+                   n_rows, n_cols,
+                   [&](auto ft)
+                   {
+                      simulateShare<typename decltype(ft)::type>
+                      (
+                         n_rows, n_cols, n_mines, n_share, firstSeed + t, unsigned(n_shares),
+                         openings[t], revealed[t]
+                      );
+                   }
+                );
+             }
+          )
+       );
+    }
+
+    for (size_t t = 0; t < threads.size(); ++t)
+    {
+       threads[t].join();
+    }
+
+    n_openings.assign(n_rows * n_cols, 0);
+    n_revealed.assign(n_rows * n_cols, 0);
+
+    for (int t = 0; t < n_shares; ++t)
+    {
+       for (int i = 0; i < n_rows * n_cols; ++i)
+       {
+          n_openings[i] += openings[t][i];
+          n_revealed[i] += revealed[t][i];
+       }
+    }
+
+    findBest();
+
+    // Append the section, starting the file if it is new (or empty).
+    FILE *file = fopen(path, "ab");
+
+    if (file == 0)
+    {
+       return false;
+    }
+
+    std::vector<unsigned char> buffer;
+
+    fseek(file, 0, SEEK_END);
+
+    if (ftell(file) == 0)
+    {
+       buffer.assign(bookMagic, bookMagic + sizeof(bookMagic));
+    }
+
+    putNumber(buffer, n_rows);
+    putNumber(buffer, n_cols);
+    putNumber(buffer, n_mines);
+    putNumber(buffer, n_boards);
+
+    for (int i = 0; i < n_rows * n_cols; ++i)
+    {
+       putNumber(buffer, n_openings[i]);
+       putNumber(buffer, n_revealed[i]);
+    }
+
+    const bool written = fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+
+    return (fclose(file) == 0) and written;
+ }
+
+} // End namespace minesweeper.
+
+// Private function definitions. ///////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ void openingBook::findBest(void)
+ {
+    int b = 0;
+
+    for (int i = 1; i < n_rows * n_cols; ++i)
+    {
+       if
+       (
+          n_openings[i] > n_openings[b] or
+          (n_openings[i] == n_openings[b] and n_revealed[i] > n_revealed[b])
+       )
+       {
+          b = i;
+       }
+    }
+
+    best = square(b / n_cols, b % n_cols);
+ }
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,97 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "book.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Opening books of first click outcomes per board size and number of mines.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef BOOK_H
+#define BOOK_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "minefield.h"
+
+#include <vector>
+
+// Book file format. ///////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * A book file is the 8 byte magic number "MSBOOK01" then any number of sections, each for
+  * one board configuration:
+  *
+  *    n_rows  n_cols  n_mines  n_boards
+  *    then for each square in row major order:  n_openings  n_revealed
+  *
+  * where n_openings is the number of the n_boards simulated boards on which a first click on
+  * the square opens an opening, and n_revealed the total squares revealed by it (0 where it
+  * is mined).  Numbers are unsigned LEB128 as in trace files.  Building a book for a
+  * configuration appends a section; loading uses the last section for the configuration.
+  */
+
+ // Class definitions. //////////////////////////////////////////////////////////////////////////
+
+ class openingBook
+ {
+  public:
+    openingBook(void) : n_rows(0), n_cols(0), n_mines(0), n_boards(0) {}
+
+    /*
+     * Load the section of the book file at path for the given configuration.  Return false if
+     * the file could not be read or has no such section.
+     */
+    bool load(const char *path, const int &n_rows, const int &n_cols, const int &n_mines);
+
+    /*
+     * Simulate first clicks on the boards with seeds firstSeed to firstSeed + n_boards - 1
+     * (split between n_threads threads) and append the section for the configuration to
+     * the book file at path (creating it if need be).  The book then holds the section.
+     * Return false if the file could not be written.
+     */
+    bool build
+    (
+       const char *path, const int &n_rows, const int &n_cols, const int &n_mines,
+       const int &n_boards, const unsigned &firstSeed, const int &n_threads
+    );
+
+    /*
+     * Return the square most likely to open an opening (breaking ties by the squares it
+     * reveals on average).  Found when the book is loaded or built.
+     */
+    const square &firstClick(void) const {return best;}
+
+    double openingProb(const square &s) const
+    {return double(n_openings[index(s)]) / n_boards;}
+
+    double expectedRevealed(const square &s) const
+    {return double(n_revealed[index(s)]) / n_boards;}
+
+    int getNboards(void) const {return n_boards;}
+
+  private:
+    int index(const square &s) const {return s.row * n_cols + s.col;}
+
+    void findBest(void);
+
+    int n_rows, n_cols, n_mines, n_boards;
+
+    std::vector<unsigned long long> n_openings, n_revealed;
+
+    square best;
+ };
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,456 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "driver.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Coroutine based game driver for playing many automated games per thread.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "driver.h"
+#include "bitboard.h"
+#include "arena.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include <cassert>
+
+// File-scope function definitions. ////////////////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ /*
+  * Run a share of a batch on one thread (see runBatch()) using a Player
+  * (gameScheduler or bitboardBatch).
+  */
+ template<class Player>
+ void runBatchShare
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const unsigned &seedStep,
+    const batchEngine &engine, const openingBook *book, const int &n_slots,
+    std::mutex &resultMutex, batchResult &result
+ )
+ {
+    std::unique_ptr<Player> player;
+
+    if constexpr (std::is_constructible<Player, int, int, int, int>::value)
+    {
+       player.reset(new Player(n_rows, n_cols, n_mines, n_slots));
+    }
+    else
+    {
+       player.reset(new Player(n_rows, n_cols, n_mines));
+    }
+
+    if constexpr (requires {player->setOpeningBook(book);})
+    {
+       player->setOpeningBook(book);
+    }
+
+    if constexpr (requires {player->setGuessEngine(true);})
+    {
+       player->setGuessEngine(engine == engineGuess);
+    }
+
+    long n_won = 0, n_guesses = 0;
+    player->run(firstSeed, seedStep, n_games, n_won, n_guesses);
+
+    std::lock_guard<std::mutex> lock(resultMutex);
+    result.n_games   += n_games;
+    result.n_won     += n_won;
+    result.n_guesses += n_guesses;
+
+    if constexpr (requires {player->memoryUsage(result.memory);})
+    {
+       result.n_slots = n_slots;
+       player->memoryUsage(result.memory);
+    }
+ }
+
+ /*
+  *
+  */
+ template<class Player>
+ batchResult runBatchT
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const int &n_threads,
+    const batchEngine &engine, const openingBook *book, const int &n_slots
+ )
+ {
+    batchResult result;
+    std::mutex  resultMutex;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Thread t plays seeds firstSeed + t, firstSeed + t + n_threads, ...
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t)
+    {
+       const int n_share = (n_games - t + n_threads - 1) / n_threads;
+
+       threads.push_back
+       (
+          std::thread
+          (
+             runBatchShare<Player>, n_rows, n_cols, n_mines, n_share,
+             firstSeed + t, unsigned(n_threads), engine, book, n_slots,
+             std::ref(resultMutex), std::ref(result)
+          )
+       );
+    }
+
+    for (size_t t = 0; t < threads.size(); ++t)
+    {
+       threads[t].join();
+    }
+
+    result.seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return result;
+ }
+
+} // End anonymous namespace.
+
+// Function definitions. ///////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Play a game, exploring every square the solver deduces to be clear and flagging every
+  * square it deduces to be mined, and suspending whenever a decision is needed.
+  */
+ template<class Field>
+ gameTask playAutoGame(Field &M, basicMineFieldProbMap<Field> &P)
+ {
+    gameResult result;
+    square t;
+
+    std::vector<square> clear; // Squares found clear in each round.
+
+    // NOTE: The results of co_yield initialise new variables rather than being assigned,
+    //       as GCC 12 rejects assignment from co_yield inside a function template.
+    square s = co_yield decideFirstClick;
+
+    for (;;)
+    {
+       if (not M.explore(s))
+       {
+          co_return result; // Mined.
+       }
+
+       while (not M.gameWon() and P.update())
+       {
+          clear.clear();
+
+          for (t.row = 0; t.row < M.getHeight(); ++t.row)
+          {
+             for (t.col = 0; t.col < M.getWidth(); ++t.col)
+             {
+                if      (P.squareClear(t) and not M.squareExplored(t)) {clear.push_back(t);}
+                else if (P.squareMined(t) and not M.squareFlagged(t))  {M.flagSquare(t);   }
+             }
+          }
+
+          M.exploreMany(clear);
+       }
+
+       if (M.gameWon())
+       {
+          result.won = true;
+          co_return result;
+       }
+
+       ++result.n_guesses;
+       const square guess = co_yield decideGuess;
+       s = guess;
+    }
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ square chooseSquare
+ (
+    const Field &M, const basicMineFieldProbMap<Field> &P,
+    const decisionType &d, std::minstd_rand &rng, const openingBook *book
+ )
+ {
+    if (d == decideFirstClick)
+    {
+       return (book != 0)? book->firstClick(): square(M.getHeight() / 2, M.getWidth() / 2);
+    }
+
+    // Count candidates, then pick the chosen one on a second pass (avoids a list).
+    square s;
+    int n_candidates = 0;
+
+    for (s.row = 0; s.row < M.getHeight(); ++s.row)
+    {
+       for (s.col = 0; s.col < M.getWidth(); ++s.col)
+       {
+          n_candidates += (not M.squareExplored(s) and not P.squareKnown(s));
+       }
+    }
+
+    assert(n_candidates > 0);
+
+    int n = rng() % n_candidates;
+
+    for (s.row = 0; s.row < M.getHeight(); ++s.row)
+    {
+       for (s.col = 0; s.col < M.getWidth(); ++s.col)
+       {
+          if (not M.squareExplored(s) and not P.squareKnown(s) and n-- == 0)
+          {
+             return s;
+          }
+       }
+    }
+
+    return s;
+ }
+
+ /*
+  * Constructor.
+  */
+ template<class Field>
+ gameScheduler<Field>::gameScheduler
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines, const int &n_slots
+ )
+ : book(0)
+ {
+    for (int i = 0; i < n_slots; ++i)
+    {
+       slots.push_back(std::unique_ptr<slot>(new slot(n_rows, n_cols, n_mines)));
+    }
+ }
+
+ /*
+  * Round robin over the slots: start a game in each empty slot while games remain, and
+  * resume each game in progress with the decision it is waiting for.
+  */
+ template<class Field>
+ void gameScheduler<Field>::run
+ (
+    const unsigned &firstSeed, const unsigned &seedStep, const int &n_games,
+    long &n_won, long &n_guesses
+ )
+ {
+    int n_started = 0, n_active;
+
+    do
+    {
+       n_active = 0;
+
+       for (size_t i = 0; i < slots.size(); ++i)
+       {
+          slot &S = *slots[i];
+
+          if (S.task.valid() and S.task.done())
+          {
+             n_won     += S.task.getResult().won;
+             n_guesses += S.task.getResult().n_guesses;
+             S.task = gameTask();
+          }
+
+          if (not S.task.valid() and n_started < n_games)
+          {
+             const unsigned seed = firstSeed + n_started * seedStep;
+             ++n_started;
+
+             S.M.reset(seed);
+             S.P.reset();
+             S.rng.seed(seed);
+             S.task = playAutoGame(S.M, S.P);
+             S.task.resume(); // Run to first decision point.
+          }
+
+          if (S.task.valid())
+          {
+             ++n_active;
+
+             if (guesser and S.task.pendingDecision() == decideGuess)
+             {
+                S.task.resume(guesser->choose(S.M, S.P));
+             }
+             else
+             {
+                S.task.resume(chooseSquare(S.M, S.P, S.task.pendingDecision(), S.rng, book));
+             }
+          }
+       }
+    }
+    while (n_active > 0);
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ std::size_t gameScheduler<Field>::memoryUsage(memoryReport &report) const
+ {
+    std::size_t total = 0;
+
+    for (const std::unique_ptr<slot> &S: slots)
+    {
+       total += S->M.memoryUsage(report) + S->P.memoryUsage(report);
+    }
+
+    const std::size_t scratch = threadScratch().capacity();
+    report.add("solver scratch arena", scratch);
+
+    const std::size_t other =
+    sizeof(*this) + heapBytes(slots) +
+    slots.size() * (sizeof(slot) - sizeof(Field) - sizeof(basicMineFieldProbMap<Field>)) +
+    (guesser? sizeof(guessEngine<Field>): 0);
+    report.add("scheduler other", other);
+
+    return total + scratch + other;
+ }
+
+ /*
+  * The thread's scratch arena, shared by the slots, is counted once.
+  */
+ template<class Field>
+ std::size_t gameScheduler<Field>::estimateMemoryUsage
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines, const int &n_slots
+ )
+ {
+    const std::size_t perSlot =
+    sizeof(std::unique_ptr<slot>) + sizeof(slot) - sizeof(Field) -
+    sizeof(basicMineFieldProbMap<Field>) + Field::estimateMemoryUsage(n_rows, n_cols, n_mines) +
+    basicMineFieldProbMap<Field>::estimateMemoryUsage(n_rows, n_cols);
+
+    return
+    (
+       sizeof(gameScheduler) + n_slots * perSlot +
+       basicMineFieldProbMap<Field>::estimateScratchUsage(n_rows, n_cols)
+    );
+ }
+
+ /*
+  *
+  */
+ batchResult runBatch
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const int &n_threads,
+    const batchEngine &engine, const openingBook *book, const int &n_slots
+ )
+ {
+    if (engine == engineBitboard)
+    {
+       assert(bitboardBatch::fits(n_rows, n_cols));
+
+       return runBatchT<bitboardBatch>
+       (
+          n_rows, n_cols, n_mines, n_games, firstSeed, std::max(1, n_threads), engine, book,
+          n_slots
+       );
+    }
+
+    return dispatchFieldType
+    (
+       n_rows, n_cols,
+       [&](auto ft)
+       {
+          return runBatchT< gameScheduler<typename decltype(ft)::type> >
+          (
+             n_rows, n_cols, n_mines, n_games, firstSeed, std::max(1, n_threads), engine,
+             book, n_slots
+          );
+       }
+    );
+ }
+
+ /*
+  *
+  */
+ int slotsWithinBudget
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines, const int &n_threads,
+    const std::size_t &memoryBudget, const int &maxSlots
+ )
+ {
+    return dispatchFieldType
+    (
+       n_rows, n_cols,
+       [&](auto ft)
+       {
+          typedef gameScheduler<typename decltype(ft)::type> scheduler;
+
+          const std::size_t perThread = memoryBudget / std::max(1, n_threads);
+
+          int n = maxSlots;
+
+          while (n > 0 and scheduler::estimateMemoryUsage(n_rows, n_cols, n_mines, n) > perThread)
+          {
+             --n;
+          }
+
+          return n;
+       }
+    );
+ }
+
+} // End namespace minesweeper.
+
+// Explicit instantiations. ////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ template class gameScheduler<mineField>;
+ template class gameScheduler< mineFieldT< 8,  8> >;
+ template class gameScheduler< mineFieldT<16, 16> >;
+ template class gameScheduler< mineFieldT<16, 30> >;
+
+ template gameTask playAutoGame(mineField &, mineFieldProbMap &);
+ template gameTask playAutoGame(mineFieldT< 8,  8> &, mineFieldProbMapT< 8,  8> &);
+ template gameTask playAutoGame(mineFieldT<16, 16> &, mineFieldProbMapT<16, 16> &);
+ template gameTask playAutoGame(mineFieldT<16, 30> &, mineFieldProbMapT<16, 30> &);
+
+ template square chooseSquare
+ (
+    const mineField &, const mineFieldProbMap &, const decisionType &, std::minstd_rand &,
+    const openingBook *
+ );
+ template square chooseSquare
+ (
+    const mineFieldT< 8,  8> &, const mineFieldProbMapT< 8,  8> &, const decisionType &,
+    std::minstd_rand &, const openingBook *
+ );
+ template square chooseSquare
+ (
+    const mineFieldT<16, 16> &, const mineFieldProbMapT<16, 16> &, const decisionType &,
+    std::minstd_rand &, const openingBook *
+ );
+ template square chooseSquare
+ (
+    const mineFieldT<16, 30> &, const mineFieldProbMapT<16, 30> &, const decisionType &,
+    std::minstd_rand &, const openingBook *
+ );
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,259 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "driver.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Coroutine based game driver for playing many automated games per thread.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef DRIVER_H
+#define DRIVER_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "minefield.h"
+#include "mineprob.h"
+#include "book.h"
+#include "guess.h"
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Class definitions. //////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Decision points at which a game suspends to be told which square to explore.
+  */
+ enum decisionType
+ {
+    decideFirstClick, // No squares explored yet.
+    decideGuess       // The solver can deduce nothing more.
+ };
+
+ class gameResult
+ {
+  public:
+    gameResult(void) : won(false), n_guesses(0) {}
+
+    bool won;
+    int  n_guesses; // Number of decideGuess decisions (not counting the first click).
+ };
+
+ /*
+  * Handle to a game coroutine.  The coroutine suspends initially, and at each decision
+  * point ("square s = co_yield decisionType;").  The owner resumes it with resume(s).
+  */
+ class gameTask
+ {
+  public:
+    class promise_type;
+    typedef std::coroutine_handle<promise_type> handle;
+
+    class decisionAwaiter
+    {
+     public:
+       bool   await_ready(void) const noexcept {return false;}
+       void   await_suspend(handle) const noexcept {}
+       square await_resume(void) const noexcept {return p->decision;}
+
+       promise_type *p;
+    };
+
+    class promise_type
+    {
+     public:
+       gameTask get_return_object(void) {return gameTask(handle::from_promise(*this));}
+
+       std::suspend_always initial_suspend(void) noexcept {return std::suspend_always();}
+       std::suspend_always final_suspend(void)   noexcept {return std::suspend_always();}
+
+       decisionAwaiter yield_value(const decisionType &d)
+       {decisionAwaiter a; a.p = this; pending = d; return a;}
+
+       void return_value(const gameResult &r) {result = r;}
+       void unhandled_exception(void) {std::terminate();}
+
+       decisionType pending;  // Decision the game is waiting for.
+       square       decision; // Decision supplied by resume().
+       gameResult   result;   // Valid once the game is done.
+    };
+
+    gameTask(void) : h(0) {}
+    explicit gameTask(handle _h) : h(_h) {}
+    gameTask(gameTask &&t) : h(t.h) {t.h = 0;}
+    gameTask &operator=(gameTask &&t) {destroy(); h = t.h; t.h = 0; return *this;}
+    ~gameTask(void) {destroy();}
+
+    bool valid(void) const {return bool(h);}
+    bool done(void)  const {return h.done();}
+
+    decisionType      pendingDecision(void) const {return h.promise().pending;}
+    const gameResult &getResult(void)       const {return h.promise().result;}
+
+    /* Resume the game, supplying decision s if it is waiting at a decision point. */
+    void resume(void) {h.resume();}
+    void resume(const square &s) {h.promise().decision = s; h.resume();}
+
+  private:
+    void destroy(void) {if (h) {h.destroy(); h = 0;}}
+
+    handle h;
+ };
+
+ /*
+  * Play a game on M (already reset) using solver P (already reset), suspending at each
+  * decision point.  M and P must outlive the game.
+  */
+ template<class Field>
+ gameTask playAutoGame(Field &M, basicMineFieldProbMap<Field> &P);
+
+ /*
+  * Default decision policy: first click on the book's square if a book (for the board's
+  * configuration) is given, otherwise in the centre of the board; guesses uniformly at
+  * random among squares that are unexplored and not known to be mined.
+  */
+ template<class Field>
+ square chooseSquare
+ (
+    const Field &M, const basicMineFieldProbMap<Field> &P,
+    const decisionType &d, std::minstd_rand &rng, const openingBook *book = 0
+ );
+
+ /*
+  * Interleaves up to n_slots games at once on the calling thread.  Each slot owns a
+  * minefield and solver that are reused by every game played in it.
+  */
+ template<class Field>
+ class gameScheduler
+ {
+  public:
+    gameScheduler
+    (
+       const int &n_rows, const int &n_cols, const int &n_mines, const int &n_slots = 64
+    );
+
+    /*
+     * Play the games with seeds firstSeed, firstSeed + seedStep, ... (n_games in all),
+     * adding results to n_won and n_guesses.
+     */
+    void run
+    (
+       const unsigned &firstSeed, const unsigned &seedStep, const int &n_games,
+       long &n_won, long &n_guesses
+    );
+
+    /* Choose first clicks from book (for the scheduler's configuration), or 0 for none. */
+    void setOpeningBook(const openingBook *_book) {book = _book;}
+
+    /* Choose guesses with a guessEngine rather than at random (see chooseSquare()). */
+    void setGuessEngine(const bool &use)
+    {guesser.reset(use? new guessEngine<Field>(): 0);}
+
+    /*
+     * Add the bytes used by the slots' minefields and solvers to report, and those held by the
+     * calling thread's scratch arena (used by the solvers' updates).
+     */
+    std::size_t memoryUsage(memoryReport &report) const;
+
+    /* Return an estimate of the memory used by a gameScheduler with n_slots slots. */
+    static std::size_t estimateMemoryUsage
+    (
+       const int &n_rows, const int &n_cols, const int &n_mines, const int &n_slots
+    );
+
+  private:
+    class slot
+    {
+     public:
+       slot(const int &n_rows, const int &n_cols, const int &n_mines)
+       : M(n_rows, n_cols, n_mines), P(&M)
+       {P.setVerbose(false);}
+
+       Field                        M;
+       basicMineFieldProbMap<Field> P;
+       gameTask                     task;
+       std::minstd_rand             rng; // Seeded per game, so results do not depend
+                                         // on which slot or thread plays the game.
+    };
+
+    std::vector< std::unique_ptr<slot> > slots;
+
+    const openingBook *book;
+
+    std::unique_ptr< guessEngine<Field> > guesser; // Shared by the slots.
+ };
+
+ extern template class gameScheduler<mineField>;
+ extern template class gameScheduler< mineFieldT< 8,  8> >;
+ extern template class gameScheduler< mineFieldT<16, 16> >;
+ extern template class gameScheduler< mineFieldT<16, 30> >;
+
+ /*
+  * Engines available to runBatch().
+  */
+ enum batchEngine
+ {
+    engineProbMap, // gameScheduler (basicMineFieldProbMap solver).
+    engineGuess,   // gameScheduler choosing guesses with a guessEngine.
+    engineBitboard // bitboardBatch (boards of at most 64 squares only).
+ };
+
+ /*
+  * Totals for runBatch().
+  */
+ class batchResult
+ {
+  public:
+    batchResult(void) : n_games(0), n_won(0), n_guesses(0), seconds(0.0), n_slots(0) {}
+
+    long         n_games, n_won, n_guesses;
+    double       seconds;
+    int          n_slots; // Games interleaved per thread (0 for bitboardBatch).
+    memoryReport memory;  // Memory used by the threads' schedulers (summed over threads).
+ };
+
+ // Function declarations. //////////////////////////////////////////////////////////////////////
+
+ /*
+  * Play n_games automated games with seeds firstSeed to firstSeed + n_games - 1, split
+  * between n_threads threads each running a gameScheduler (or bitboardBatch).  Totals do
+  * not depend on n_threads (except with engineGuess, whose choices are limited in time).  If
+  * book is given, first clicks are chosen from it (by gameScheduler only).  Each
+  * gameScheduler interleaves n_slots games, which does not change the totals either.
+  */
+ batchResult runBatch
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const int &n_threads,
+    const batchEngine &engine = engineProbMap, const openingBook *book = 0,
+    const int &n_slots = 64
+ );
+
+ /*
+  * Return the most slots (up to maxSlots) each of n_threads gameSchedulers may have for the
+  * estimated memory used by the schedulers of runBatch() to stay within memoryBudget bytes,
+  * or 0 if not even one slot per thread fits.
+  */
+ int slotsWithinBudget
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines, const int &n_threads,
+    const std::size_t &memoryBudget, const int &maxSlots = 64
+ );
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
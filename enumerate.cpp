@@ -0,0 +1,298 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "enumerate.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Exact enumeration of the mine assignments of frontier components.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "enumerate.h"
+#include "arena.h"
+
+#include <cassert>
+#include <cstddef>
+
+// File-scope definitions. /////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ inline int popcount(const uint64_t &m) {return __builtin_popcountll(m);}
+
+ /*
+  * Depth first search over the cells of a component, in the order chosen by
+  * enumerateComponent().  Cells after the last constrained cell (n_constrained) are free and
+  * are counted combinatorially at each leaf rather than enumerated.
+  */
+ class componentSearch
+ {
+  public:
+    componentSearch
+    (
+       const scratchVector<componentConstraint> &_constraints,
+       const scratchVector< scratchVector<int> > &_constraintsByCell,
+       const scratchVector<int> &_cellOrder, const int &_n_constrained, const int &_maxMines,
+       const double &_maxVisited, const std::chrono::steady_clock::time_point &_deadline,
+       componentCounts &_counts
+    )
+    : constraints(_constraints), constraintsByCell(_constraintsByCell), cellOrder(_cellOrder),
+      n_constrained(_n_constrained), n_free(int(_cellOrder.size()) - _n_constrained),
+      maxMines(_maxMines), maxVisited(_maxVisited), deadline(_deadline),
+      limited(_deadline != std::chrono::steady_clock::time_point::max()),
+      n_untilCheck(deadlineCheckInterval), counts(_counts)
+    {
+       // Pascal's triangle up to n_free, for spreading mines over the free cells.
+       binomial.resize(n_free + 1);
+
+       for (int n = 0; n <= n_free; ++n)
+       {
+          binomial[n].assign(n + 1, 1.0);
+
+          for (int k = 1; k < n; ++k)
+          {
+             binomial[n][k] = binomial[n - 1][k - 1] + binomial[n - 1][k];
+          }
+       }
+    }
+
+    /* Return false if the budget of partial assignments or the time ran out. */
+    bool search(const int &cell, const uint64_t &mines, const int &n_mines)
+    {
+       if (++counts.n_visited > maxVisited)
+       {
+          return false;
+       }
+
+       if (limited and --n_untilCheck == 0)
+       {
+          n_untilCheck = deadlineCheckInterval;
+
+          if (std::chrono::steady_clock::now() >= deadline)
+          {
+             counts.deadlineReached = true;
+             return false;
+          }
+       }
+
+       if (cell == n_constrained)
+       {
+          tally(mines, n_mines);
+          return true;
+       }
+
+       const uint64_t bit = uint64_t(1) << cell;
+
+       // Cells before and including this one are assigned.
+       const uint64_t unassigned = (cell == 63)? 0: ~((bit << 1) - 1);
+
+       if (consistent(cell, mines, unassigned) and not search(cell + 1, mines, n_mines))
+       {
+          return false;
+       }
+
+       if (n_mines < maxMines and consistent(cell, mines | bit, unassigned))
+       {
+          return search(cell + 1, mines | bit, n_mines + 1);
+       }
+
+       return true;
+    }
+
+  private:
+    /*
+     * Only the constraints containing the cell just assigned can have changed state.
+     */
+    bool consistent(const int &cell, const uint64_t &mines, const uint64_t &unassigned) const
+    {
+       for (const int &c: constraintsByCell[cell])
+       {
+          const uint64_t mask    = constraints[c].mask;
+          const int      n_mined = popcount(mines & mask);
+
+          if (n_mined > constraints[c].count or
+              n_mined + popcount(unassigned & mask) < constraints[c].count)
+          {
+             return false;
+          }
+       }
+
+       return true;
+    }
+
+    void tally(const uint64_t &mines, const int &n_mines)
+    {
+       for (int f = 0; f <= n_free and n_mines + f <= maxMines; ++f)
+       {
+          const int    k = n_mines + f;
+          const double w = binomial[n_free][f];
+
+          counts.n_solutions[k] += w;
+
+          for (uint64_t m = mines; m != 0; m &= m - 1)
+          {
+             counts.n_mined[k][cellOrder[__builtin_ctzll(m)]] += w;
+          }
+
+          // Each free cell is mined in C(n_free - 1, f - 1) of the ways of placing f mines.
+          if (f > 0)
+          {
+             const double wFree = binomial[n_free - 1][f - 1];
+
+             for (int i = n_constrained; i < n_constrained + n_free; ++i)
+             {
+                counts.n_mined[k][cellOrder[i]] += wFree;
+             }
+          }
+       }
+    }
+
+    const scratchVector<componentConstraint>  &constraints;
+    const scratchVector< scratchVector<int> > &constraintsByCell;
+    const scratchVector<int>                  &cellOrder;
+
+    const int    n_constrained, n_free, maxMines;
+    const double maxVisited;
+
+    const std::chrono::steady_clock::time_point deadline;
+    const bool                                  limited;
+    int                                         n_untilCheck;
+
+    scratchVector< scratchVector<double> > binomial;
+
+    componentCounts &counts;
+ };
+}
+
+// Public function definitions. ////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ bool enumerateComponent
+ (
+    const int &n_cells, const std::vector<componentConstraint> &constraints,
+    const int &maxMines, componentCounts &counts, const double &maxVisited,
+    const std::chrono::steady_clock::time_point &deadline
+ )
+ {
+    assert(0 <= n_cells and n_cells <= 64);
+
+    const int          n_constraints = int(constraints.size());
+    const scratchScope scope; // The working data below is released on return.
+
+    // Order the cells breadth first over the constraint graph, so that the cells of each
+    // constraint are assigned close together and contradictions are found near the root.
+    scratchVector<int>  cellOrder;
+    scratchVector<int>  newIndex(n_cells, -1);
+    scratchVector<bool> constraintQueued(n_constraints, false);
+    scratchVector<int>  queue;
+
+    cellOrder.reserve(n_cells);
+    queue.reserve(n_constraints);
+
+    for (int start = 0; start < n_constraints; ++start)
+    {
+       if (constraintQueued[start])
+       {
+          continue;
+       }
+
+       constraintQueued[start] = true;
+       queue.assign(1, start);
+
+       for (std::size_t q = 0; q < queue.size(); ++q)
+       {
+          for (uint64_t m = constraints[queue[q]].mask; m != 0; m &= m - 1)
+          {
+             const int i = __builtin_ctzll(m);
+
+             if (newIndex[i] != -1)
+             {
+                continue;
+             }
+
+             newIndex[i] = int(cellOrder.size());
+             cellOrder.push_back(i);
+
+             for (int c = 0; c < n_constraints; ++c)
+             {
+                if (not constraintQueued[c] and (constraints[c].mask >> i & 1))
+                {
+                   constraintQueued[c] = true;
+                   queue.push_back(c);
+                }
+             }
+          }
+       }
+    }
+
+    const int n_constrained = int(cellOrder.size());
+
+    for (int i = 0; i < n_cells; ++i)
+    {
+       if (newIndex[i] == -1)
+       {
+          newIndex[i] = int(cellOrder.size());
+          cellOrder.push_back(i);
+       }
+    }
+
+    // Remap the constraint masks to the new order, and index them by cell.
+    scratchVector<componentConstraint>  remapped(n_constraints);
+    scratchVector< scratchVector<int> > constraintsByCell(n_cells);
+
+    for (int c = 0; c < n_constraints; ++c)
+    {
+       remapped[c].count = constraints[c].count;
+
+       for (uint64_t m = constraints[c].mask; m != 0; m &= m - 1)
+       {
+          const int j = newIndex[__builtin_ctzll(m)];
+
+          remapped[c].mask |= uint64_t(1) << j;
+          constraintsByCell[j].push_back(c);
+       }
+    }
+
+    counts.n_cells         = n_cells;
+    counts.n_visited       = 0.0;
+    counts.deadlineReached = false;
+    counts.n_solutions.assign(n_cells + 1, 0.0);
+    counts.n_mined.resize(n_cells + 1);
+
+    for (std::vector<double> &m: counts.n_mined)
+    {
+       m.assign(n_cells, 0.0); // (Reusing the storage of counts of an earlier component.)
+    }
+
+    // A constraint that can never be met (not reached by the search if it has no cells).
+    for (int c = 0; c < n_constraints; ++c)
+    {
+       if (constraints[c].count < 0 or constraints[c].count > popcount(constraints[c].mask))
+       {
+          return true;
+       }
+    }
+
+    return componentSearch
+    (
+       remapped, constraintsByCell, cellOrder, n_constrained, maxMines, maxVisited, deadline,
+       counts
+    ).search(0, 0, 0);
+ }
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,98 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "enumerate.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Exact enumeration of the mine assignments of frontier components.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef ENUMERATE_H
+#define ENUMERATE_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <vector>
+
+#include <stdint.h>
+
+// Class definitions. //////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * A frontier component is a set of at most 64 unknown squares (cells, numbered from 0)
+  * linked by constraints, each saying that a subset of the cells (bit i of mask for cell i)
+  * holds exactly count mines.
+  */
+ class componentConstraint
+ {
+  public:
+    componentConstraint(const uint64_t &_mask = 0, const int &_count = 0)
+    : mask(_mask), count(_count)
+    {}
+
+    uint64_t mask;
+    int      count;
+ };
+
+ inline bool operator==(const componentConstraint &a, const componentConstraint &b)
+ {return a.mask == b.mask and a.count == b.count;}
+
+ inline bool operator<(const componentConstraint &a, const componentConstraint &b)
+ {return a.mask < b.mask or (a.mask == b.mask and a.count < b.count);}
+
+ /*
+  * Result of enumerateComponent(), bucketed by the total number of mines k in the component
+  * (0 <= k <= n_cells).  Counts are held as doubles as they may exceed 2^64.
+  */
+ class componentCounts
+ {
+  public:
+    int n_cells;
+
+    std::vector<double>                n_solutions; // [k] Assignments with k mines.
+    std::vector< std::vector<double> > n_mined;     // [k][i] Those with cell i mined.
+
+    double n_visited;       // Partial assignments visited by the search (for measuring).
+    bool   deadlineReached; // The search was stopped by the deadline.
+ };
+
+ // Constants. //////////////////////////////////////////////////////////////////////////////////
+
+ const int deadlineCheckInterval = 4096;
+
+ // Function declarations. //////////////////////////////////////////////////////////////////////
+
+ /*
+  * Count the assignments of mines to the n_cells cells of a component (n_cells <= 64) that
+  * satisfy every constraint and have at most maxMines mines.  Return false, leaving the counts
+  * incomplete, if the search would visit more than maxVisited partial assignments or the
+  * deadline passes (then counts.deadlineReached is set).  The clock is read only once every
+  * deadlineCheckInterval partial assignments.
+  *
+  * Assignments are built as uint64_t masks by a depth first search over the cells, ordered
+  * so that constraints are completed as early as possible.  After each cell is assigned,
+  * the constraints containing it are checked using popcount of the mines assigned and the
+  * cells unassigned in each mask, and the branch is abandoned if any can no longer be met.
+  */
+ bool enumerateComponent
+ (
+    const int &n_cells, const std::vector<componentConstraint> &constraints,
+    const int &maxMines, componentCounts &counts, const double &maxVisited = 1e300,
+    const std::chrono::steady_clock::time_point &deadline =
+    std::chrono::steady_clock::time_point::max()
+ );
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
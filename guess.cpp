@@ -0,0 +1,128 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "guess.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Choice of the square to explore when the solver can deduce nothing more.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "guess.h"
+
+#include <algorithm>
+
+#include <cassert>
+
+// Function definitions. ///////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * A guess has two outcomes: the square is mined, which ends the game, or it is clear.  Only
+  * the second is looked ahead from, by assuming the square clear and counting what update()
+  * then deduces (the number the square would show is unknown without the hidden map).
+  * Candidates are looked at safest first, so the safest square is chosen if time runs out.
+  * If time runs out while counting, the candidates are ranked by the probabilities update()
+  * set instead, with squares of unknown probability last.
+  */
+ template<class Field>
+ square guessEngine<Field>::choose(const Field &M, basicMineFieldProbMap<Field> &P)
+ {
+    const std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + budget;
+
+    // Sets probabilities even if none became certain.
+    P.updateProbabilities(M.getNmines(), deadline);
+
+    candidates.clear();
+
+    square s;
+
+    for (s.row = 0; s.row < M.getHeight(); ++s.row)
+    {
+       for (s.col = 0; s.col < M.getWidth(); ++s.col)
+       {
+          if (M.squareExplored(s) or P.squareMined(s))
+          {
+             continue;
+          }
+
+          candidate c;
+          c.s    = s;
+          c.p    = P.probKnown(s)? P.getProbMined(s): 1.0;
+          c.gain = 0;
+
+          if (c.p == 0.0)
+          {
+             probMined = 0.0;
+             return s; // Found clear by counting: no need to guess.
+          }
+
+          candidates.push_back(c);
+       }
+    }
+
+    assert(not candidates.empty());
+
+    const int n = std::min(int(candidates.size()), maxCandidates);
+
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end());
+
+    const bool verbose = P.getVerbose();
+    P.setVerbose(false);
+
+    int best = 0;
+
+    for (int i = 0; i < n and candidates[i].p <= candidates[0].p + tolerance; ++i)
+    {
+       candidate &c = candidates[i];
+
+       P.pushSnapshot();
+       P.assumeSquareClear(c.s);
+
+       const updateStatus status = P.update(deadline);
+
+       c.gain = P.getSnapshotChanges() - 1; // Not counting the assumption itself.
+       P.popSnapshot();
+
+       if (status != updateComplete)
+       {
+          break; // Out of time: the gain is incomplete.
+       }
+
+       if (c.gain > candidates[best].gain)
+       {
+          best = i;
+       }
+    }
+
+    P.setVerbose(verbose);
+
+    probMined = candidates[best].p;
+
+    return candidates[best].s;
+ }
+
+} // End namespace minesweeper.
+
+// Explicit instantiations. ////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ template class guessEngine<mineField>;
+ template class guessEngine< mineFieldT< 8,  8> >;
+ template class guessEngine< mineFieldT<16, 16> >;
+ template class guessEngine< mineFieldT<16, 30> >;
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,89 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "guess.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Choice of the square to explore when the solver can deduce nothing more.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef GUESS_H
+#define GUESS_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "minefield.h"
+#include "mineprob.h"
+
+#include <chrono>
+#include <vector>
+
+// Class definitions. //////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Ranks the unexplored squares of a stalled game by the probability of each being mined
+  * (see updateProbabilities() in "mineprob.h") and, among the safest, by the number of
+  * squares the solver could deduce if it were clear.  The look-ahead is done on the solver
+  * itself, inside a snapshot, so nothing is copied.  Each choice takes at most about the
+  * time budget; squares not looked at in time are not chosen.
+  */
+ template<class Field>
+ class guessEngine
+ {
+  public:
+    guessEngine
+    (
+       const std::chrono::microseconds &_budget = std::chrono::milliseconds(10),
+       const int &_maxCandidates = 8, const double &_tolerance = 0.02
+    )
+    : budget(_budget), maxCandidates(_maxCandidates), tolerance(_tolerance), probMined(1.0) {}
+
+    /*
+     * Return the square to explore next in the game on M, given solver P which has been
+     * update()d and can deduce nothing more.  P is left with the mine probabilities of all
+     * unknown squares set, unless the time budget ran out while counting them.  At least one
+     * square must be unexplored and not known mined.
+     */
+    square choose(const Field &M, basicMineFieldProbMap<Field> &P);
+
+    /* Return the probability that the square last chosen was mined. */
+    double getProbMined(void) const {return probMined;}
+
+  private:
+    class candidate
+    {
+     public:
+       bool operator<(const candidate &c) const {return p < c.p;}
+
+       square s;
+       double p;    // Probability of being mined.
+       int    gain; // Squares deduced if s were clear.
+    };
+
+    std::chrono::microseconds budget;
+    int                       maxCandidates; // Most squares looked ahead from per choice.
+    double                    tolerance;     // Squares up to this much more likely to be
+                                             // mined than the safest are looked ahead from.
+    double                    probMined;
+
+    std::vector<candidate> candidates;
+ };
+
+ extern template class guessEngine<mineField>;
+ extern template class guessEngine< mineFieldT< 8,  8> >;
+ extern template class guessEngine< mineFieldT<16, 16> >;
+ extern template class guessEngine< mineFieldT<16, 30> >;
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,196 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "image.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Export of minefields and probability maps as binary PPM images.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "image.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <cstdint>
+#include <cstdio>
+
+// File-scope function definitions. ////////////////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ class rgb
+ {
+  public:
+    rgb(const int &_r, const int &_g, const int &_b) : r(_r), g(_g), b(_b) {}
+
+    unsigned char r, g, b;
+ };
+
+ /*
+  * Write an n_rows x n_cols image (before downsampling) to path, where colour(r, c) gives
+  * the colour of pixel (r, c).  Rows are built in a buffer the width of the output image
+  * (plus sums for downsampling) and written one at a time.
+  */
+ template<class ColourFunction>
+ bool writePPM
+ (
+    const char *path, const int &n_rows, const int &n_cols, int downsample,
+    const ColourFunction &colour
+ )
+ {
+    downsample = std::max(1, downsample);
+
+    const int outRows = (n_rows + downsample - 1) / downsample,
+              outCols = (n_cols + downsample - 1) / downsample;
+
+    FILE *file = fopen(path, "wb");
+
+    if (file == 0)
+    {
+       return false;
+    }
+
+    // A block sums up to 255 * downsample^2, too much for 32 bits once downsample > 4096.
+    std::vector<unsigned char> row(3 * outCols);
+    std::vector<uint64_t>      sums((downsample > 1)? 3 * outCols: 0);
+
+    fprintf(file, "P6\n%d %d\n255\n", outCols, outRows);
+
+    for (int outR = 0; outR < outRows; ++outR)
+    {
+       const int r0 = outR * downsample, r1 = std::min(n_rows, r0 + downsample);
+
+       if (downsample == 1)
+       {
+          for (int c = 0; c < n_cols; ++c)
+          {
+             const rgb p = colour(r0, c);
+             row[3 * c] = p.r; row[3 * c + 1] = p.g; row[3 * c + 2] = p.b;
+          }
+       }
+       else
+       {
+          std::fill(sums.begin(), sums.end(), 0);
+
+          for (int r = r0; r < r1; ++r)
+          {
+             for (int c = 0; c < n_cols; ++c)
+             {
+                const rgb p = colour(r, c);
+                uint64_t *s = &sums[3 * (c / downsample)];
+                s[0] += p.r; s[1] += p.g; s[2] += p.b;
+             }
+          }
+
+          for (int outC = 0; outC < outCols; ++outC)
+          {
+             const int c0 = outC * downsample, c1 = std::min(n_cols, c0 + downsample);
+             const uint64_t n = uint64_t(r1 - r0) * (c1 - c0);
+
+             for (int i = 0; i < 3; ++i)
+             {
+                row[3 * outC + i] = (sums[3 * outC + i] + n / 2) / n;
+             }
+          }
+       }
+
+       if (fwrite(&row[0], 1, row.size(), file) != row.size())
+       {
+          fclose(file);
+          return false;
+       }
+    }
+
+    return fclose(file) == 0;
+ }
+}
+
+// Function definitions. ///////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ template<class Field>
+ bool exportBoardImage(const Field &M, const char *path, const int &downsample)
+ {
+    return writePPM
+    (
+       path, M.getHeight(), M.getWidth(), downsample,
+       [&M](const int &r, const int &c)
+       {
+          if (M.squareExplored(r, c))
+          {
+             const int shade = 255 - 24 * M.n_minedNbours(r, c);
+             return rgb(shade, shade, 255);
+          }
+
+          return (M.squareFlagged(r, c))? rgb(224, 32, 32): rgb(96, 96, 96);
+       }
+    );
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ bool exportProbImage
+ (
+    const Field &M, const basicMineFieldProbMap<Field> &P, const char *path,
+    const int &downsample
+ )
+ {
+    return writePPM
+    (
+       path, M.getHeight(), M.getWidth(), downsample,
+       [&P](const int &r, const int &c)
+       {
+          const square s(r, c);
+
+          if (not P.probKnown(s))
+          {
+             return rgb(48, 48, 48);
+          }
+
+          const int red = int(255.0 * P.getProbMined(s) + 0.5);
+          return rgb(red, 255 - red, 0);
+       }
+    );
+ }
+
+} // End namespace minesweeper.
+
+// Explicit instantiations. ////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ template bool exportBoardImage(const mineField &, const char *, const int &);
+ template bool exportBoardImage(const mineFieldT< 8,  8> &, const char *, const int &);
+ template bool exportBoardImage(const mineFieldT<16, 16> &, const char *, const int &);
+ template bool exportBoardImage(const mineFieldT<16, 30> &, const char *, const int &);
+
+ template bool exportProbImage
+ (const mineField &, const mineFieldProbMap &, const char *, const int &);
+ template bool exportProbImage
+ (const mineFieldT< 8,  8> &, const mineFieldProbMapT< 8,  8> &, const char *, const int &);
+ template bool exportProbImage
+ (const mineFieldT<16, 16> &, const mineFieldProbMapT<16, 16> &, const char *, const int &);
+ template bool exportProbImage
+ (const mineFieldT<16, 30> &, const mineFieldProbMapT<16, 30> &, const char *, const int &);
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,55 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "image.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Export of minefields and probability maps as binary PPM images.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "minefield.h"
+#include "mineprob.h"
+
+// Function declarations. //////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Write the exploration state of M to path as a binary PPM (P6) image with one pixel per
+  * square, or if downsample > 1 one pixel per downsample x downsample block of squares
+  * (the average colour of the block).  Unexplored squares are grey, flagged squares red and
+  * explored squares white shading to blue with the number of mined neighbours.
+  *
+  * Images are written one row at a time, so memory used is proportional to the width.
+  * Return false if the file could not be written.
+  */
+ template<class Field>
+ bool exportBoardImage(const Field &M, const char *path, const int &downsample = 1);
+
+ /*
+  * As exportBoardImage(), but write a heatmap of the probability map P of M.  Squares whose
+  * probability is unknown are dark grey, others shade from green (clear) to red (mined).
+  */
+ template<class Field>
+ bool exportProbImage
+ (
+    const Field &M, const basicMineFieldProbMap<Field> &P, const char *path,
+    const int &downsample = 1
+ );
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
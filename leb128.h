@@ -0,0 +1,70 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "leb128.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Unsigned LEB128 numbers, as used by the trace, stats, book and shard files.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef LEB128_H
+#define LEB128_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <cstddef>
+
+// Function definitions. ///////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /* Append n to buffer as unsigned LEB128. */
+ inline void putNumber(std::vector<unsigned char> &buffer, unsigned long long n)
+ {
+    while (n >= 0x80)
+    {
+       buffer.push_back((n & 0x7f) | 0x80);
+       n >>= 7;
+    }
+
+    buffer.push_back(n);
+ }
+
+ /*
+  * Read an unsigned LEB128 number at data[pos], advancing pos.  Return false at the end of
+  * data or if the number runs on past 64 bits.
+  */
+ inline bool getNumber
+ (
+    const std::vector<unsigned char> &data, std::size_t &pos, unsigned long long &n
+ )
+ {
+    n = 0;
+
+    for (int shift = 0; shift < 64 and pos < data.size(); shift += 7)
+    {
+       const unsigned char b = data[pos++];
+       n |= (unsigned long long)(b & 0x7f) << shift;
+
+       if (not (b & 0x80))
+       {
+          return true;
+       }
+    }
+
+    return false;
+ }
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
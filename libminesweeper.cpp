@@ -0,0 +1,140 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "libminesweeper.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: C interface to the minesweeper solver.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "libminesweeper.h"
+#include "boardview.h"
+#include "mineprob.h"
+
+#include <exception>
+
+// Type definitions. ///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The board view points at the caller's buffer only for the duration of each ms_solve() call.
+ */
+struct ms_solver
+{
+   ms_solver(const int &n_rows, const int &n_cols)
+   : view(n_rows, n_cols), probMap(&view)
+   {
+      probMap.setVerbose(false);
+   }
+
+   minesweeper::boardView                                     view;
+   minesweeper::basicMineFieldProbMap<minesweeper::boardView> probMap;
+};
+
+// Function definitions. ///////////////////////////////////////////////////////////////////////////
+
+int ms_api_version(void)
+{
+   return MS_API_VERSION;
+}
+
+ms_solver *ms_solver_create(int n_rows, int n_cols)
+{
+   if (n_rows < 1 or n_cols < 1 or std::size_t(n_rows) * std::size_t(n_cols) > MS_MAX_SQUARES)
+   {
+      return 0;
+   }
+
+   // The constructor allocates, so catch here rather than rely on new (std::nothrow), which
+   // only covers the allocation of the ms_solver itself.
+   try
+   {
+      return new ms_solver(n_rows, n_cols);
+   }
+   catch (const std::exception &)
+   {
+      return 0;
+   }
+}
+
+void ms_solver_destroy(ms_solver *solver)
+{
+   delete solver;
+}
+
+size_t ms_solver_memory_usage(const ms_solver *solver)
+{
+   if (solver == 0)
+   {
+      return 0;
+   }
+
+   return
+   sizeof(ms_solver) - sizeof(solver->probMap) + solver->probMap.memoryUsage() +
+   minesweeper::heapBytes(solver->view.getFrontier());
+}
+
+int ms_solve
+(
+   ms_solver *solver, const unsigned char *cells, unsigned char *deductions, double *probs
+)
+{
+   using minesweeper::square;
+
+   if (solver == 0 or cells == 0 or deductions == 0)
+   {
+      return -MS_ERROR_ARGUMENT;
+   }
+
+   // Exceptions must not cross the C interface.  Memory can only run out here while growing
+   // the scratch memory of the calling thread, which has no fixed bound.
+   try
+   {
+      solver->view.setCells(cells);
+      solver->probMap.reset();
+      solver->probMap.update();
+   }
+   catch (const std::exception &)
+   {
+      solver->view.setCells(0);
+      return -MS_ERROR_MEMORY;
+   }
+
+   const minesweeper::boardView &V = solver->view;
+   int n_deduced = 0;
+   square s;
+
+   for (s.row = 0; s.row < V.getHeight(); ++s.row)
+   {
+      for (s.col = 0; s.col < V.getWidth(); ++s.col)
+      {
+         const int i = s.row * V.getWidth() + s.col;
+
+         if      (solver->probMap.squareClear(s)) {deductions[i] = MS_DEDUCED_CLEAR;}
+         else if (solver->probMap.squareMined(s)) {deductions[i] = MS_DEDUCED_MINED;}
+         else                                     {deductions[i] = MS_DEDUCED_NONE; }
+
+         if (deductions[i] != MS_DEDUCED_NONE and not V.squareExplored(s))
+         {
+            ++n_deduced;
+         }
+
+         if (probs != 0)
+         {
+            probs[i] = solver->probMap.getProbMined(s);
+         }
+      }
+   }
+
+   solver->view.setCells(0);
+
+   return n_deduced;
+}
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,98 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "libminesweeper.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: C interface to the minesweeper solver (libminesweeper.a / libminesweeper.so).
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef LIBMINESWEEPER_H
+#define LIBMINESWEEPER_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Constants. //////////////////////////////////////////////////////////////////////////////////////
+
+#define MS_API_VERSION 3
+
+/* Largest board (n_rows * n_cols) for which a solver may be created (since version 3). */
+#define MS_MAX_SQUARES (1 << 24)
+
+/*
+ * Board cell values (one byte per square, row major, caller owned).
+ * Values 0 - 8 mean the square is explored and that many mines lie in surrounding squares.
+ */
+#define MS_CELL_UNKNOWN 0xff
+#define MS_CELL_FLAGGED 0xfe /* Treated as unexplored: flags are not trusted by the solver. */
+
+/* Deduction values (one byte per square, row major, caller owned). */
+#define MS_DEDUCED_NONE  0 /* Unexplored and state not known.   */
+#define MS_DEDUCED_CLEAR 1 /* Explored, or known to be clear.   */
+#define MS_DEDUCED_MINED 2 /* Known to be mined.                */
+
+/* Error codes (returned as negative values). */
+#define MS_ERROR_ARGUMENT 1
+#define MS_ERROR_MEMORY   2 /* Since version 3. */
+
+#if defined(__GNUC__)
+#define MS_API __attribute__((visibility("default")))
+#else
+#define MS_API
+#endif
+
+// Types. //////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct ms_solver ms_solver;
+
+// Function declarations. //////////////////////////////////////////////////////////////////////////
+
+/* Return MS_API_VERSION of the library linked against. */
+MS_API int ms_api_version(void);
+
+/*
+ * Create a solver for boards of the given dimensions.  All memory the solver needs is allocated
+ * here, so that ms_solve() does no heap allocation.  Returns 0 if either dimension is less
+ * than one, if the board has more than MS_MAX_SQUARES squares, or if memory runs out.
+ */
+MS_API ms_solver *ms_solver_create(int n_rows, int n_cols);
+
+MS_API void ms_solver_destroy(ms_solver *solver);
+
+/*
+ * Return the bytes of memory held by the solver (since version 2).  Not counted is the
+ * scratch memory of the calling thread used by ms_solve(), which is shared by all solvers
+ * and kept between calls only while it is at most 16 MiB.
+ */
+MS_API size_t ms_solver_memory_usage(const ms_solver *solver);
+
+/*
+ * Deduce what can be known about the board 'cells' (n_rows * n_cols bytes).
+ * Writes one MS_DEDUCED_* value per square to 'deductions', and if 'probs' is not null,
+ * the probability that each square is mined to 'probs' (-1.0 where not known).
+ * Returns the number of unexplored squares whose state was deduced, or -MS_ERROR_*.
+ */
+MS_API int ms_solve
+(
+   ms_solver *solver, const unsigned char *cells, unsigned char *deductions, double *probs
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
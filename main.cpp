@@ -16,19 +16,59 @@
 
 #include "minefield.h"
 #include "mineprob.h"
+#include "driver.h"
+#include "bitboard.h"
+#include "server.h"
+#include "speculate.h"
+#include "render.h"
+#include "image.h"
+#include "trace.h"
+#include "validate.h"
+#include "analytics.h"
+#include "book.h"
+#include "tournament.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <cstdio>
 #include <cstdlib>
 
+#include <sys/ioctl.h>
+#include <unistd.h>
+
 // File-scope function declarations. ///////////////////////////////////////////////////////////////
 
 namespace
 {
  using namespace minesweeper;
 
- bool autoExplore(mineField &M, mineFieldProbMap &P);
- int playGame(int, int, int);
+ template<class Field>
+ bool autoExplore
+ (
+    Field &M, basicMineFieldProbMap<Field> &P,
+    const typename speculativeSolver<Field>::outcome *solved = 0,
+    boardRenderer<Field> *view = 0, traceWriter *trace = 0
+ );
+
+ template<class Field>
+ bool viewCommand(boardRenderer<Field> &view, const std::string &command);
+
+ template<class Field>
+ int playGame(int, int, int, traceWriter *trace = 0, std::size_t memoryBudget = 0);
+
+ template<class Field>
+ int exportGameImages(int, int, int, unsigned, const std::string &, int);
+
+ int  runOption
+ (
+    int argc, char *argv[], const char *bookPath = 0, std::size_t memoryBudget = 0
+ );
+ void printUsage(void);
 }
 
 // Main function definition. ///////////////////////////////////////////////////////////////////////
@@ -44,6 +84,11 @@ int main(int argc, char *argv[])
    int n_rows, n_cols, n_mines;
    std::string settingsTypeStr;
 
+   if (argc > 1 and argv[1][0] == '-')
+   {
+      return runOption(argc, argv);
+   }
+
    switch (argc)
    {
     case 1:
@@ -61,8 +106,7 @@ int main(int argc, char *argv[])
       n_mines = atoi(argv[3]);
       break;
     default:
-      std::cout << "Minsweeper Text\n"
-                << "Usage: minesweeper_text <int n_rows> <int n_cols> <int n_mines>\n";
+      printUsage();
       exit(EXIT_SUCCESS);
    }
 
@@ -71,7 +115,12 @@ int main(int argc, char *argv[])
              << n_cols  << " cols, "
              << n_mines << " mines.\n\n";
 
-   return playGame(n_rows, n_cols, n_mines);
+   // Use a fixed size minefield where one exists for the dimensions chosen.
+   return dispatchFieldType
+   (
+      n_rows, n_cols,
+      [&](auto ft) {return playGame<typename decltype(ft)::type>(n_rows, n_cols, n_mines);}
+   );
 }
 
 // File-scope function definitions. ////////////////////////////////////////////////////////////////
@@ -84,14 +133,599 @@ namespace
  /*
   *
   */
- int playGame(int n_rows, int n_cols, int n_mines)
+ void printUsage(void)
+ {
+    std::cout << "Minsweeper Text\n"
+              << "Usage: minesweeper_text <int n_rows> <int n_cols> <int n_mines>\n"
+              << "       minesweeper_text --mem-budget <int megabytes> <int n_rows> <int n_cols>"
+              <<                " <int n_mines>\n"
+              << "       minesweeper_text [--mem-budget <int megabytes>] [--book <book file>]"
+              <<                " --batch[-guess|-bitboard] <int n_rows> <int n_cols>"
+              <<                " <int n_mines> <int n_games> [int first_seed] [int n_threads]\n"
+              << "       minesweeper_text --build-book <book file> <int n_rows> <int n_cols>"
+              <<                " <int n_mines> <int n_boards> [int first_seed] [int n_threads]\n"
+              << "       minesweeper_text --validate[-library|-probabilities] <int n_rows>"
+              <<                " <int n_cols>"
+              <<                " <int n_mines> <int n_games> [int first_seed] [int n_threads]\n"
+              << "       minesweeper_text --export-image <int n_rows> <int n_cols> <int n_mines>"
+              <<                " <int seed> <file prefix> [int downsample]\n"
+              << "       minesweeper_text --record <trace file> <int n_rows> <int n_cols>"
+              <<                " <int n_mines>\n"
+              << "       minesweeper_text --replay <trace file>\n"
+              << "       minesweeper_text --analyse[-boards] <stats file> <int n_rows> <int n_cols>"
+              <<                " <int n_mines> <int n_boards> [int first_seed] [int n_threads]\n"
+              << "       minesweeper_text --tournament <shard file> <int n_rows> <int n_cols>"
+              <<                " <int n_mines> <int n_games> <int first_seed> <int shard>/<int"
+              <<                " n_shards> [int n_threads]\n"
+              << "       minesweeper_text --merge <shard file> [shard file ...]\n"
+              << "       minesweeper_text --server <socket path> [int n_workers]"
+              <<                " [int max_squares]\n"
+              << "       minesweeper_text --server-stats <socket path>\n"
+              << "       minesweeper_text --server-stop <socket path>\n";
+ }
+
+ /*
+  * Run the mode selected by the command line option argv[1].  bookPath is the book file given
+  * with --book (before the option), if any, and memoryBudget the bytes given (in megabytes)
+  * with --mem-budget, or 0 for no budget.
+  */
+ int runOption(int argc, char *argv[], const char *bookPath, std::size_t memoryBudget)
+ {
+    using std::cout;
+    using std::cerr;
+    using std::endl;
+
+    const std::string option(argv[1]);
+
+    if (option == "--book" and argc >= 4 and bookPath == 0)
+    {
+       return runOption(argc - 2, argv + 2, argv[2], memoryBudget);
+    }
+
+    if (option == "--mem-budget" and argc >= 4 and memoryBudget == 0 and atoi(argv[2]) > 0)
+    {
+       return runOption(argc - 2, argv + 2, bookPath, std::size_t(atoi(argv[2])) << 20);
+    }
+
+    // Interactive play within a memory budget.
+    if (memoryBudget != 0 and bookPath == 0 and argc == 4 and option[0] != '-')
+    {
+       const int n_rows = atoi(argv[1]), n_cols = atoi(argv[2]), n_mines = atoi(argv[3]);
+
+       return dispatchFieldType
+       (
+          n_rows, n_cols,
+          [&](auto ft)
+          {
+             return playGame<typename decltype(ft)::type>
+             (
+                n_rows, n_cols, n_mines, 0, memoryBudget
+             );
+          }
+       );
+    }
+
+    if
+    (
+       (option == "--batch" or option == "--batch-guess" or option == "--batch-bitboard") and
+       6 <= argc and argc <= 8
+    )
+    {
+       const int      n_rows    = atoi(argv[2]), n_cols = atoi(argv[3]);
+       const unsigned firstSeed = (argc >= 7)? strtoul(argv[6], 0, 10): 1;
+       const int      n_threads = (argc == 8)? atoi(argv[7]): 1;
+       const bool     bitboard  = (option == "--batch-bitboard");
+       const bool     guess     = (option == "--batch-guess");
+
+       if (bitboard and not bitboardBatch::fits(n_rows, n_cols))
+       {
+          cerr << "Bitboard batches are limited to boards of at most 64 squares." << endl;
+          return EXIT_FAILURE;
+       }
+
+       openingBook book;
+
+       if (bookPath != 0 and not book.load(bookPath, n_rows, n_cols, atoi(argv[4])))
+       {
+          cerr << "No opening book for this configuration in '" << bookPath << "'." << endl;
+          return EXIT_FAILURE;
+       }
+
+       // Within a budget, fewer games are interleaved per thread (bitboards need no budget).
+       int n_slots = 64;
+
+       if (memoryBudget != 0 and not bitboard)
+       {
+          n_slots = slotsWithinBudget
+          (
+             n_rows, n_cols, atoi(argv[4]), std::max(1, n_threads), memoryBudget, n_slots
+          );
+
+          if (n_slots == 0)
+          {
+             cerr << "A batch of " << n_rows << "x" << n_cols << " boards on " << n_threads
+                  << " thread(s) needs more than the memory budget." << endl;
+             return EXIT_FAILURE;
+          }
+       }
+
+       const batchResult result = runBatch
+       (
+          n_rows, n_cols, atoi(argv[4]), atoi(argv[5]), firstSeed, n_threads,
+          (bitboard? engineBitboard: guess? engineGuess: engineProbMap), (bookPath != 0)? &book: 0,
+          n_slots
+       );
+
+       cout << "Games: "      << result.n_games
+            << ", won: "      << result.n_won
+            << " ("           << 100.0 * result.n_won / std::max(1L, result.n_games) << "%)"
+            << ", guesses: "  << result.n_guesses << "." << endl
+            << "Time: "       << result.seconds   << " s"
+            << " ("           << result.n_games * 3600.0 / result.seconds << " games/hour)."
+            << endl;
+
+       if (result.n_slots > 0)
+       {
+          cout << "Memory: " << result.memory.total() << " bytes ("
+               << result.n_slots << " games interleaved per thread):" << endl;
+          result.memory.print(cout, "   ");
+       }
+
+       return EXIT_SUCCESS;
+    }
+
+    if
+    (
+       (
+          option == "--validate" or option == "--validate-library" or
+          option == "--validate-probabilities"
+       ) and
+       6 <= argc and argc <= 8
+    )
+    {
+       const int      n_rows    = atoi(argv[2]), n_cols = atoi(argv[3]);
+       const unsigned firstSeed = (argc >= 7)? strtoul(argv[6], 0, 10): 1;
+       const int      n_threads = (argc == 8)? atoi(argv[7]): 1;
+       const bool     library   = (option == "--validate-library");
+       const bool     prob      = (option == "--validate-probabilities");
+
+       if (n_threads < 1)
+       {
+          cerr << "The number of threads must be at least 1." << endl;
+          return EXIT_FAILURE;
+       }
+
+       const validateResult result = runValidation
+       (
+          n_rows, n_cols, atoi(argv[4]), atoi(argv[5]), firstSeed, n_threads,
+          (library? validateLibrary: prob? validateProbabilities: validateFixedSize)
+       );
+
+       if (result.n_positions == 0)
+       {
+          cerr << "No positions validated";
+
+          if (not library and not prob)
+          {
+             cerr << " (there may be no fixed-size minefield type for "
+                  << n_rows << "x" << n_cols << " boards)";
+          }
+
+          cerr << "." << endl;
+          return EXIT_FAILURE;
+       }
+
+       for (size_t i = 0; i < result.reports.size(); ++i)
+       {
+          cout << result.reports[i] << endl;
+       }
+
+       cout << "Positions: "            << result.n_positions
+            << ", deductions: reference " << result.n_refDeductions
+            << " ("                     << result.n_refWrong  << " wrong)"
+            << ", candidate "           << result.n_candDeductions
+            << " ("                     << result.n_candWrong << " wrong)." << endl
+            << "Missed by candidate: "  << result.n_missing
+            << ", found only by candidate: " << result.n_extra << "." << endl
+            << "Solving time: reference "    << result.refSeconds  << " s"
+            << ", candidate "           << result.candSeconds << " s"
+            << " (speedup "             << result.refSeconds / result.candSeconds << ")."
+            << endl;
+
+       if (prob)
+       {
+          cout << "Probabilities checked by brute force on " << result.n_probPositions
+               << " positions: " << result.n_probWrong << " wrong"
+               << " (largest difference " << result.maxProbError << ")." << endl;
+       }
+
+       const bool passed =
+       (
+          result.n_refWrong == 0 and result.n_candWrong == 0 and result.n_missing == 0 and
+          result.n_probWrong == 0
+       );
+
+       return (passed)? EXIT_SUCCESS: EXIT_FAILURE;
+    }
+
+    if (option == "--export-image" and (argc == 7 or argc == 8))
+    {
+       const int n_rows = atoi(argv[2]), n_cols = atoi(argv[3]), n_mines = atoi(argv[4]);
+       const unsigned seed = strtoul(argv[5], 0, 10);
+       const int downsample = (argc == 8)? atoi(argv[7]): 1;
+
+       return dispatchFieldType
+       (
+          n_rows, n_cols,
+          [&](auto ft)
+          {
+             return exportGameImages<typename decltype(ft)::type>
+             (
+                n_rows, n_cols, n_mines, seed, argv[6], downsample
+             );
+          }
+       );
+    }
+
+    if (option == "--record" and argc == 6)
+    {
+       const int n_rows = atoi(argv[3]), n_cols = atoi(argv[4]), n_mines = atoi(argv[5]);
+       traceWriter trace;
+
+       if (not trace.open(argv[2], n_rows, n_cols, n_mines))
+       {
+          cerr << "Could not create trace file '" << argv[2] << "'." << endl;
+          return EXIT_FAILURE;
+       }
+
+       return dispatchFieldType
+       (
+          n_rows, n_cols,
+          [&](auto ft)
+          {return playGame<typename decltype(ft)::type>(n_rows, n_cols, n_mines, &trace);}
+       );
+    }
+
+    if (option == "--replay" and argc == 3)
+    {
+       traceReplayResult result;
+
+       if (not replayTrace(argv[2], result))
+       {
+          cerr << "Could not replay trace file '" << argv[2] << "'." << endl;
+          return EXIT_FAILURE;
+       }
+
+       cout << "Games: "       << result.n_games
+            << ", actions: "   << result.n_actions
+            << ", updates: "   << result.n_updates
+            << " ("            << result.n_mismatches << " with results differing from trace)."
+            << endl
+            << "Time: "        << result.seconds << " s." << endl;
+
+       return (result.n_mismatches == 0)? EXIT_SUCCESS: EXIT_FAILURE;
+    }
+
+    if (option == "--build-book" and 7 <= argc and argc <= 9)
+    {
+       const unsigned firstSeed = (argc >= 8)? strtoul(argv[7], 0, 10): 1;
+       const int      n_threads = (argc == 9)? atoi(argv[8]): 1;
+       openingBook    book;
+
+       const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+       if
+       (
+          not book.build
+          (
+             argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]), firstSeed,
+             n_threads
+          )
+       )
+       {
+          cerr << "Could not write book file '" << argv[2] << "'." << endl;
+          return EXIT_FAILURE;
+       }
+
+       const double seconds =
+       std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+       cout << "Best first click: "   << book.firstClick()
+            << " (opening on "        << 100.0 * book.openingProb(book.firstClick()) << "%"
+            << " of boards, revealing " << book.expectedRevealed(book.firstClick())
+            << " squares on average)." << endl
+            << "Time: "               << seconds << " s"
+            << " ("                   << book.getNboards() / seconds << " boards/s)." << endl;
+
+       return EXIT_SUCCESS;
+    }
+
+    if ((option == "--analyse" or option == "--analyse-boards") and 7 <= argc and argc <= 9)
+    {
+       const int      n_rows    = atoi(argv[3]), n_cols = atoi(argv[4]);
+       const unsigned firstSeed = (argc >= 8)? strtoul(argv[7], 0, 10): 1;
+       const int      n_threads = (argc == 9)? atoi(argv[8]): 1;
+       const bool     solve     = (option == "--analyse");
+       analyticsResult result;
+
+       if
+       (
+          not runAnalytics
+          (
+             n_rows, n_cols, atoi(argv[5]), atoi(argv[6]), firstSeed, n_threads, solve,
+             argv[2], result
+          )
+       )
+       {
+          cerr << "Could not write stats file '" << argv[2] << "'." << endl;
+          return EXIT_FAILURE;
+       }
+
+       const double n = std::max(1L, result.n_boards);
+
+       cout << "Boards: "         << result.n_boards
+            << ", mean 3BV: "     << result.bbbv        / n
+            << ", openings: "     << result.n_openings  / n
+            << " (revealing "     << result.openingArea / n << " squares)"
+            << ", islands: "      << result.n_islands   / n << "." << endl;
+
+       if (solve)
+       {
+          cout << "Highest test order: none " << result.n_maxTestOrder[0]
+               << ", simple "                 << result.n_maxTestOrder[1]
+               << ", 1 other square "         << result.n_maxTestOrder[2]
+               << ", 2 "                      << result.n_maxTestOrder[3]
+               << ", 3 "                      << result.n_maxTestOrder[4] << "." << endl
+               << "Won: "                     << result.n_won
+               << ", guesses: "               << result.n_guesses
+               << ", mean largest frontier at a guess: " << result.maxFrontier / n << "."
+               << endl;
+       }
+
+       cout << "Time: " << result.seconds << " s"
+            << " ("     << result.n_boards * 60.0 / result.seconds << " boards/minute)." << endl;
+
+       return EXIT_SUCCESS;
+    }
+
+    if (option == "--tournament" and (argc == 9 or argc == 10))
+    {
+       const int n_threads = (argc == 10)? atoi(argv[9]): 1;
+       int       shard, n_shards;
+
+       if
+       (
+          sscanf(argv[8], "%d/%d", &shard, &n_shards) != 2 or
+          shard < 0 or shard >= n_shards
+       )
+       {
+          cerr << "Shard must be given as i/n with 0 <= i < n." << endl;
+          return EXIT_FAILURE;
+       }
+
+       tournamentTotals shardTotals;
+
+       // Progress of this shard and of all shards of the tournament playing on this host.
+       const auto progress = [&](const tournamentTotals &s, const tournamentTotals &l)
+       {
+          cout << "\rShard: "         << s.n_games << " games, " << s.n_won << " won."
+               << "  All local shards: " << l.n_games << " games, " << l.n_won << " won."
+               << std::flush;
+       };
+
+       if
+       (
+          not runShard
+          (
+             atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), atoi(argv[6]),
+             strtoul(argv[7], 0, 10), shard, n_shards, n_threads, argv[2], shardTotals, progress
+          )
+       )
+       {
+          cerr << "Could not write shard file '" << argv[2] << "'." << endl;
+          return EXIT_FAILURE;
+       }
+
+       cout << endl
+            << "Shard " << shard << "/" << n_shards << ": " << shardTotals.n_games << " games, "
+            << shardTotals.n_won << " won, " << shardTotals.n_guesses << " guesses." << endl;
+
+       return EXIT_SUCCESS;
+    }
+
+    if (option == "--merge" and argc >= 3)
+    {
+       const std::vector<const char *> paths(argv + 2, argv + argc);
+       mergeResult result;
+
+       if (not mergeShards(paths, result))
+       {
+          cerr << "Could not merge the shard files (unreadable, of different tournaments or"
+               << " overlapping)." << endl;
+          return EXIT_FAILURE;
+       }
+
+       const tournamentTotals &t = result.totals;
+
+       cout << "Tournament: "  << result.n_rows << "x" << result.n_cols << ", "
+            << result.n_mines  << " mines, seeds " << result.firstSeed << " to "
+            << result.firstSeed + result.n_games - 1 << "." << endl
+            << "Games: "       << t.n_games
+            << ", won: "       << t.n_won
+            << " ("            << 100.0 * t.n_won / std::max(1L, t.n_games) << "%)"
+            << ", guesses: "   << t.n_guesses << "." << endl;
+
+       if (result.n_missing > 0)
+       {
+          cout << "Missing: " << result.n_missing << " games." << endl;
+       }
+
+       return EXIT_SUCCESS;
+    }
+
+    if (option == "--server" and 3 <= argc and argc <= 5)
+    {
+       const int  n_workers  = (argc >= 4)? atoi(argv[3]): std::thread::hardware_concurrency();
+       const long maxSquares = (argc == 5)? atol(argv[4]): 1L << 20;
+
+       if (not runServer(argv[2], n_workers, maxSquares))
+       {
+          cerr << "Could not listen on socket '" << argv[2] << "'." << endl;
+          return EXIT_FAILURE;
+       }
+
+       return EXIT_SUCCESS;
+    }
+
+    if ((option == "--server-stats" or option == "--server-stop") and argc == 3)
+    {
+       const int fd = connectToServer(argv[2]);
+       serverStatsReply stats;
+
+       if (fd < 0)
+       {
+          cerr << "Could not connect to socket '" << argv[2] << "'." << endl;
+          return EXIT_FAILURE;
+       }
+
+       if (option == "--server-stop")
+       {
+          serverShutdown(fd);
+       }
+       else if (serverStats(fd, stats))
+       {
+          cout << "Solves: "            << stats.n_solved
+               << " in "                << stats.n_batches  << " batches." << endl
+               << "Latency (us): p50 "  << stats.latencyP50
+               << ", p90 "              << stats.latencyP90
+               << ", p99 "              << stats.latencyP99
+               << ", max "              << stats.latencyMax << "." << endl;
+       }
+
+       close(fd);
+       return EXIT_SUCCESS;
+    }
+
+    printUsage();
+    return EXIT_SUCCESS;
+ }
+
+ /*
+  * Play the automated game with the given seed (as --batch does) then write images of the
+  * final board and probability map to <prefix>-board.ppm and <prefix>-prob.ppm.
+  */
+ template<class Field>
+ int exportGameImages
+ (
+    int n_rows, int n_cols, int n_mines, unsigned seed, const std::string &prefix,
+    int downsample
+ )
+ {
+    using std::cout;
+    using std::cerr;
+    using std::endl;
+
+    Field                        M(n_rows, n_cols, n_mines);
+    basicMineFieldProbMap<Field> P(&M);
+    std::minstd_rand             rng(seed);
+
+    M.reset(seed);
+    P.reset();
+    P.setVerbose(false);
+
+    gameTask task = playAutoGame(M, P);
+    for (task.resume(); not task.done();)
+    {
+       task.resume(chooseSquare(M, P, task.pendingDecision(), rng));
+    }
+
+    cout << "Game " << (task.getResult().won? "won": "lost") << " after "
+         << task.getResult().n_guesses << " guesses." << endl;
+
+    P.updateProbabilities(n_mines); // So that the image shades squares not deduced.
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const std::string boardPath = prefix + "-board.ppm", probPath = prefix + "-prob.ppm";
+
+    if
+    (
+       not exportBoardImage(M, boardPath.c_str(), downsample) or
+       not exportProbImage(M, P, probPath.c_str(), downsample)
+    )
+    {
+       cerr << "Could not write '" << boardPath << "' or '" << probPath << "'." << endl;
+       return EXIT_FAILURE;
+    }
+
+    cout << "Wrote " << boardPath << " and " << probPath << " in "
+         << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+         << " s." << endl;
+
+    return EXIT_SUCCESS;
+ }
+
+ /*
+  * Play interactive games.  If trace is given, each game is recorded to it.  If memoryBudget
+  * (bytes) is given, moves are solved in advance only as far as it allows, and nothing is
+  * played if the game itself does not fit.
+  */
+ template<class Field>
+ int playGame(int n_rows, int n_cols, int n_mines, traceWriter *trace, std::size_t memoryBudget)
  {
     using std::cout;
     using std::cin;
     using std::endl;
 
-    mineField        M(n_rows, n_cols, n_mines);
-    mineFieldProbMap P(&M);
+    const std::chrono::milliseconds probMapTime(200); // Time to count the probability map in.
+
+    int maxCandidates = 64;
+
+    if (memoryBudget != 0)
+    {
+       const std::size_t game =
+       Field::estimateMemoryUsage(n_rows, n_cols, n_mines) +
+       basicMineFieldProbMap<Field>::estimateMemoryUsage(n_rows, n_cols) +
+       basicMineFieldProbMap<Field>::estimateScratchUsage(n_rows, n_cols);
+
+       if (game > memoryBudget)
+       {
+          std::cerr << "A " << n_rows << "x" << n_cols << " game needs " << game
+                    << " bytes, more than the memory budget." << endl;
+          return EXIT_FAILURE;
+       }
+
+       while
+       (
+          maxCandidates > 0 and memoryBudget - game <
+          speculativeSolver<Field>::estimateMemoryUsage(n_rows, n_cols, n_mines, maxCandidates)
+       )
+       {
+          --maxCandidates;
+       }
+
+       cout << "Solving up to " << maxCandidates << " moves in advance within the memory budget."
+            << endl << endl;
+    }
+
+    Field                        M(n_rows, n_cols, n_mines);
+    basicMineFieldProbMap<Field> P(&M);
+    speculativeSolver<Field>     speculator(maxCandidates);
+
+    // Boards too large to print on the terminal are drawn in a viewport (updated in place)
+    // instead, with the solver's progress messages turned off as they would scroll it.
+    std::unique_ptr< boardRenderer<Field> > view;
+    winsize terminal;
+
+    if
+    (
+       isatty(STDOUT_FILENO) and ioctl(STDOUT_FILENO, TIOCGWINSZ, &terminal) == 0 and
+       (n_rows + 8 > terminal.ws_row or 2 * n_cols > terminal.ws_col)
+    )
+    {
+       view.reset(new boardRenderer<Field>(M, &P, terminal.ws_row - 8, terminal.ws_col / 2));
+       P.setVerbose(false);
+    }
 
     square s;
  
@@ -103,14 +737,64 @@ namespace
     {
        M.reset();
        P.reset();
+
+       if (trace) {trace->newGame(M.getSeed());}
  
        gameOver = false;
+       bool moved = true; // The game has changed since candidate moves were last started.
        while (!gameOver)
        {
-          M.printMap();
+          // The probability map shows the probabilities of squares not deduced as well.  They
+          // are counted (for at most probMapTime) under a snapshot popped once drawn, so that
+          // the game and its trace are the same whichever map is shown.
+          const bool showProbs = view and view->getMode() == boardRenderer<Field>::showProbMap;
+
+          if (showProbs)
+          {
+             P.pushSnapshot();
+             P.updateProbabilities(M.getNmines(), std::chrono::steady_clock::now() + probMapTime);
+          }
+
+          if (view) {view->setStatus(""); view->draw(true);}
+          else      {M.printMap();                       }
+
+          if (showProbs) {P.popSnapshot();}
  
-          cout << "Explore which square? (row col) ";
-          cin >> s.row >> s.col;
+          // Solve likely moves while waiting for the player to choose one (continuing with
+          // those not yet solved if the player only scrolled the view).
+          if (moved) {speculator.start(M, P);}
+          else       {speculator.resume();   }
+
+          moved = false;
+
+          if (not view)
+          {
+             cout << "Explore which square? (row col) ";
+             cin >> s.row >> s.col;
+          }
+          else
+          {
+             cout << "Explore which square? (row col, w/a/s/d to scroll, p for probabilities) ";
+
+             std::string token;
+             cin >> token;
+
+             speculator.stop();
+
+             if (viewCommand(*view, token))
+             {
+                continue;
+             }
+
+             if (not (std::istringstream(token) >> s.row)) {s.row = -1;}
+             cin >> s.col;
+             view->followFrontier(true);
+          }
+
+          speculator.stop();
+          moved = true;
+
+          if (trace and M.squareInsideMap(s)) {trace->explore(s);}
  
           if (M.squareInsideMap(s) && !M.explore(s))
           {
@@ -123,11 +807,18 @@ namespace
           {
              if (semiAutomate)
              {
-                cout << endl;
-                M.printMap();
-                cout << endl;
+                if (view)
+                {
+                   view->draw(true);
+                }
+                else
+                {
+                   cout << endl;
+                   M.printMap();
+                   cout << endl;
+                }
  
-                autoExplore(M, P);
+                autoExplore(M, P, speculator.find(s), view.get(), trace);
                 cout << endl;
              }
  
@@ -155,9 +846,52 @@ namespace
  }
 
  /*
-  *
+  * Carry out command if it is one of the viewport keys of playGame(): 'w', 'a', 's' or 'd'
+  * scroll half a viewport up, left, down or right, and 'p' switches between the map and the
+  * probability map.  Return false if command is not one of these.
+  */
+ template<class Field>
+ bool viewCommand(boardRenderer<Field> &view, const std::string &command)
+ {
+    typedef boardRenderer<Field> renderer;
+
+    const int dRows = std::max(1, view.getViewRows() / 2);
+    const int dCols = std::max(1, view.getViewCols() / 2);
+
+    if      (command == "w") {view.scroll(-dRows,      0);}
+    else if (command == "a") {view.scroll(     0, -dCols);}
+    else if (command == "s") {view.scroll( dRows,      0);}
+    else if (command == "d") {view.scroll(     0,  dCols);}
+    else if (command == "p")
+    {
+       const bool prob = (view.getMode() == renderer::showProbMap);
+       view.setMode(prob? renderer::showMap: renderer::showProbMap);
+       return true;
+    }
+    else
+    {
+       return false;
+    }
+
+    // Stay where the player scrolled to until the next square is explored.
+    view.followFrontier(false);
+    return true;
+ }
+
+ /*
+  * Repeatedly update P, explore squares found clear and flag squares found mined.  If the
+  * move just made was solved in advance (solved != 0), replay its rounds instead of solving.
+  * If view is given each round is drawn in it (at most at its frame rate) without waiting
+  * for the player, otherwise the map is printed after each round.  If trace is given, the
+  * updates (including those replayed) and the squares explored and flagged are recorded.
   */
- bool autoExplore(mineField &M, mineFieldProbMap &P)
+ template<class Field>
+ bool autoExplore
+ (
+    Field &M, basicMineFieldProbMap<Field> &P,
+    const typename speculativeSolver<Field>::outcome *solved, boardRenderer<Field> *view,
+    traceWriter *trace
+ )
  {
     using std::cout;
     using std::endl;
@@ -165,35 +899,72 @@ namespace
     square s;
     bool mapChanged = false;
 
-    while (P.update())
+    std::vector<square> explored, flagged; // Squares found clear and mined in each round.
+
+    for (int n = 0;; ++n)
     {
+       const bool changed = (solved != 0)? n < int(solved->rounds.size()): P.update();
+
+       if (trace != 0) {trace->update(changed);}
+
+       if (not changed)
+       {
+          break;
+       }
+
        mapChanged = true;
 
-       cout << "Exploring confirmed clear squares..." << endl;
+       if (view == 0) {cout << "Exploring confirmed clear squares..." << endl;}
 
-       for (s.row = 0; s.row < M.getHeight(); ++s.row)
+       const std::vector<square> *toExplore = &explored, *toFlag = &flagged;
+
+       if (solved != 0)
+       {
+          toExplore = &solved->rounds[n].explored;
+          toFlag    = &solved->rounds[n].flagged;
+       }
+       else
        {
-          for (s.col = 0; s.col < M.getWidth(); ++s.col)
+          explored.clear();
+          flagged.clear();
+
+          for (s.row = 0; s.row < M.getHeight(); ++s.row)
           {
-             if (P.squareClear(s) and not M.squareExplored(s))
+             for (s.col = 0; s.col < M.getWidth(); ++s.col)
              {
-                M.explore(s);
-             }
-             else
-             {
-                if (P.squareMined(s) and not M.squareFlagged(s))
-                {
-                   M.flagSquare(s);
-                }
+                if      (P.squareClear(s) and not M.squareExplored(s)) {explored.push_back(s);}
+                else if (P.squareMined(s) and not M.squareFlagged(s))  {flagged.push_back(s); }
              }
           }
        }
 
-       cout << endl;
-       M.printMap();
-       cout << "Press enter to continue.";
-       std::cin.get();
-       cout << endl;
+       // The round's squares are explored together (see mineField::exploreMany()).
+       if (trace != 0)
+       {
+          for (const square &e: *toExplore) {trace->explore(e);}
+       }
+
+       M.exploreMany(*toExplore);
+
+       for (const square &f: *toFlag)
+       {
+          if (trace != 0) {trace->flag(f);}
+          M.flagSquare(f);
+       }
+
+       if (view != 0)
+       {
+          view->setStatus("Exploring confirmed clear squares...");
+          view->draw();
+       }
+       else
+       {
+          cout << endl;
+          M.printMap();
+          cout << "Press enter to continue.";
+          std::cin.get();
+          cout << endl;
+       }
 
        if (M.gameWon())
        {
@@ -201,6 +972,17 @@ namespace
        }
     }
 
+    if (solved != 0)
+    {
+       P.applySnapshotDelta(solved->delta);
+    }
+
+    if (view != 0)
+    {
+       view->setStatus("");
+       view->draw(true);
+    }
+
     return mapChanged;
  }
 
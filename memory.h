@@ -0,0 +1,131 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "memory.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Accounting of the memory used by minefields, solvers and game schedulers.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include <cstddef>
+#include <cstring>
+
+// Class definitions. //////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Bytes used by each structure of an object (and of the objects it owns), as filled in by
+  * the memoryUsage(memoryReport &) functions.  Items of the same name are combined.
+  */
+ class memoryReport
+ {
+  public:
+    class item
+    {
+     public:
+       const char *name;
+       std::size_t bytes;
+    };
+
+    void add(const char *name, const std::size_t &bytes)
+    {
+       for (item &i: items)
+       {
+          if (std::strcmp(i.name, name) == 0) {i.bytes += bytes; return;}
+       }
+
+       items.push_back(item{name, bytes});
+    }
+
+    std::size_t total(void) const
+    {
+       std::size_t t = 0;
+       for (const item &i: items) {t += i.bytes;}
+       return t;
+    }
+
+    /* Print one line per item, indented by indent. */
+    void print(std::ostream &out, const char *indent = " ") const
+    {
+       for (const item &i: items)
+       {
+          out << indent << i.name << ": " << i.bytes << " bytes" << std::endl;
+       }
+    }
+
+    std::vector<item> items;
+ };
+
+ // Function definitions. ///////////////////////////////////////////////////////////////////////
+
+ /*
+  * bytesUsed(x) is the bytes container x occupies: its own size plus the storage it owns (the
+  * capacity, not just the size, of vectors, and the storage of their elements in turn).
+  */
+ template<class T>
+ std::size_t heapBytes(const T &) {return 0;}
+
+ template<class T, class A>
+ std::size_t heapBytes(const std::vector<T, A> &v);
+
+ template<class T, std::size_t N>
+ std::size_t heapBytes(const std::array<T, N> &a);
+
+ template<class T, class A>
+ std::size_t heapBytes(const std::vector<T, A> &v)
+ {
+    if constexpr (std::is_same<T, bool>::value)
+    {
+       return (v.capacity() + 7) / 8;
+    }
+    else
+    {
+       std::size_t b = v.capacity() * sizeof(T);
+
+       if constexpr (not std::is_trivially_copyable<T>::value)
+       {
+          for (const T &e: v) {b += heapBytes(e);}
+       }
+
+       return b;
+    }
+ }
+
+ template<class T, std::size_t N>
+ std::size_t heapBytes(const std::array<T, N> &a)
+ {
+    std::size_t b = 0;
+
+    if constexpr (not std::is_trivially_copyable<T>::value)
+    {
+       for (const T &e: a) {b += heapBytes(e);}
+    }
+
+    return b;
+ }
+
+ template<class T>
+ std::size_t bytesUsed(const T &x) {return sizeof(x) + heapBytes(x);}
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
@@ -6,7 +6,7 @@
 *
 * Project: Minesweeper Text
 *
-* Purpose: Function definitions for class "mineField".
+* Purpose: Function definitions for class template "basicMineField".
 *
 * Author: Tom McDonnell 2003
 *
@@ -15,10 +15,14 @@
 // Includes. ///////////////////////////////////////////////////////////////////////////////////////
 
 #include "minefield.h"
+#include "arena.h"
 
+#include <algorithm>
 #include <iostream>
+#include <string>
 #include <cassert>
 #include <cstdlib>
+#include <ctime>
 
 // Public function definitions. ////////////////////////////////////////////////////////////////////
 
@@ -28,19 +32,22 @@ namespace minesweeper
  /*
   * Constructor.
   */
- mineField::mineField(const int &height, const int &width, const int &n)
- : n_mines(n), squaresExplored(0)
+ template<class Dims>
+ basicMineField<Dims>::basicMineField(const int &height, const int &width, const int &n)
+ : n_mines(n), epoch(0), squaresExplored(0), revealLogVersion(0),
+   frontierPos(16, frontierEntry{-1, 0}), frontierBits(4), frontierVersion(0)
  {
-    // Resize columns.
-    map.resize(height);
-    expMap.resize(height);
+    Dims::resize(expMap,      height, width);
+    Dims::resize(mineMap,     height, width);
+    Dims::resize(countMap,    height, width);
+    Dims::resizeRows(expRowEpoch, height);
 
-    // Resize rows.
-    for (int r = 0; r < getHeight(); ++r)
-    {
-       map[r].resize(width);
-       expMap[r].resize(width);
-    }
+    // reset() relies on these being clear except around the mines in mineList.
+    std::fill(expRowEpoch.begin(), expRowEpoch.end(), 0);
+    std::fill(mineMap.begin(),     mineMap.end(),     0);
+    std::fill(countMap.begin(),    countMap.end(),    0);
+
+    mineList.reserve(n_mines);
 
     reset();
  }
@@ -49,28 +56,51 @@ namespace minesweeper
   * Reset the exploration map to unexplored state and
   * lay a new set of mines in a random configuration.
   */
- void mineField::reset(void)
+ template<class Dims>
+ void basicMineField<Dims>::reset(void)
  {
-    // Reset maps.
-    for (int r = 0; r < getHeight(); ++r)
+    reset(time(NULL));
+ }
+
+ /*
+  * Reset the exploration map to unexplored state and
+  * lay a new set of mines in the configuration determined by seed.
+  */
+ template<class Dims>
+ void basicMineField<Dims>::reset(const unsigned &_seed)
+ {
+    seed = _seed;
+    rng.seed(seed);
+
+    // Reset exploration map.  Rows stamped with an earlier epoch read as unexplored.
+    if (++epoch == 0)
     {
-       for (int c = 0; c < getWidth(); ++c)
-       {
-          map   [r][c] = false; // Unmined.
-          expMap[r][c] = -1;    // Unexplored.
-       }
+       std::fill(expRowEpoch.begin(), expRowEpoch.end(), 0);
+       epoch = 1;
     }
 
     squaresExplored = 0; // Reset squaresExplored.
 
+    revealLog.clear();
+    ++revealLogVersion;
+
+    frontier.clear();
+    std::fill(frontierPos.begin(), frontierPos.end(), frontierEntry{-1, 0});
+    ++frontierVersion;
+
+    journal.clear();
+    snapshots.clear();
+
+    clearMines();
     layMines();
  }
 
  /*
   * Explore square (i, j) and update mineFieldMap[i][j].  If square has
-  * no neighboring mines, explores all adjacent squares recursively.
+  * no neighboring mines, explores all adjacent squares (see fillFromStack()).
   */
- bool mineField::explore(const square &s)
+ template<class Dims>
+ bool basicMineField<Dims>::explore(const square &s)
  {
     assert(squareInsideMap(s));
 
@@ -81,30 +111,143 @@ namespace minesweeper
 
     if (not squareExplored(s) and not squareFlagged(s))
     {
-       ++squaresExplored;
+       reveal(s);
+       fillFromStack();
+    }
+
+    return true;
+ }
 
-       expMap[s.row][s.col] = countMinedNbours(s);
+ /*
+  * Every square is revealed before any area is filled, so areas that overlap are filled
+  * together: fillFromStack() visits each square at most once whatever the order of squares.
+  */
+ template<class Dims>
+ typename basicMineField<Dims>::exploreDelta
+ basicMineField<Dims>::exploreMany(const std::span<const square> &squares)
+ {
+    const std::size_t logSize = revealLog.size();
+    bool              clear   = true;
 
-       if (n_minedNbours(s) == 0)
+    for (const square &s: squares)
+    {
+       assert(squareInsideMap(s));
+
+       if (squareMined(s))
+       {
+          clear = false;
+       }
+       else if (not squareExplored(s) and not squareFlagged(s))
        {
-          exploreNbours(s);
+          reveal(s);
        }
     }
 
-    return true;
+    fillFromStack();
+
+    return deltaSince(logSize, clear);
  }
 
  /*
-  * Print map of minefield to screen as text, hiding unexplored territory.
+  *
   */
- void mineField::printMap(void) const
+ template<class Dims>
+ typename basicMineField<Dims>::exploreDelta basicMineField<Dims>::chord(const square &s)
  {
-    using std::cout;
-    using std::endl;
+    assert(squareExplored(s));
 
-    square s;
+    const std::size_t logSize = revealLog.size();
+    bool              clear   = true;
+
+    const int t = std::max(s.row - 1, 0), b = std::min(s.row + 1, getHeight() - 1),
+              l = std::max(s.col - 1, 0), r = std::min(s.col + 1, getWidth()  - 1);
 
-    cout << "Minefield map (unexplored territory hidden)." << endl;
+    int n_flagged = 0;
+
+    for (int i = t; i <= b; ++i)
+    {
+       for (int j = l; j <= r; ++j)
+       {
+          n_flagged += squareFlagged(i, j);
+       }
+    }
+
+    if (n_flagged == n_minedNbours(s))
+    {
+       for (int i = t; i <= b; ++i)
+       {
+          for (int j = l; j <= r; ++j)
+          {
+             if (squareExplored(i, j) or squareFlagged(i, j))
+             {
+                continue;
+             }
+
+             if (squareMined(i, j)) {clear = false;       }
+             else                   {reveal(square(i, j));}
+          }
+       }
+
+       fillFromStack();
+    }
+
+    return deltaSince(logSize, clear);
+ }
+
+ /*
+  * Take a snapshot of the exploration state that can later be restored using popSnapshot().
+  */
+ template<class Dims>
+ void basicMineField<Dims>::pushSnapshot(void)
+ {
+    snapshots.push_back(snapshotMark(journal.size(), squaresExplored));
+ }
+
+ /*
+  * Restore the exploration state to that at the time of the most recent pushSnapshot().
+  */
+ template<class Dims>
+ void basicMineField<Dims>::popSnapshot(void)
+ {
+    assert(not snapshots.empty());
+
+    const snapshotMark &mark = snapshots.back();
+
+    // Undo changes in reverse order.
+    while (int(journal.size()) > mark.journalSize)
+    {
+       const expMapChange &change = journal.back();
+       const bool          unexplored = change.oldValue < 0 and expMap[change.row][change.col] >= 0;
+
+       expMap[change.row][change.col] = change.oldValue;
+
+       if (unexplored) {frontierUnexplored(square(change.row, change.col));}
+
+       journal.pop_back();
+    }
+
+    if (squaresExplored != mark.squaresExplored)
+    {
+       squaresExplored = mark.squaresExplored;
+       revealLog.resize(squaresExplored);
+       ++revealLogVersion;
+    }
+
+    snapshots.pop_back();
+ }
+
+ /*
+  * Print map of minefield to screen as text, hiding unexplored territory.  The map is built
+  * in a buffer and written at once (writing and flushing each row is slow for large maps).
+  */
+ template<class Dims>
+ void basicMineField<Dims>::printMap(void) const
+ {
+    std::string buffer("Minefield map (unexplored territory hidden).\n");
+
+    buffer.reserve(buffer.size() + getHeight() * (2 * getWidth() + 1));
+
+    square s;
 
     for (s.row = 0; s.row < getHeight(); ++s.row)
     {
@@ -112,17 +255,74 @@ namespace minesweeper
        {
           if (squareExplored(s))
           {
-             cout << n_minedNbours(s) << " ";
+             buffer += char('0' + n_minedNbours(s));
           }
           else
           {
-             if (squareFlagged(s)) {cout << "F ";}
-             else                  {cout << "- ";}
+             buffer += (squareFlagged(s))? 'F': '-';
           }
+
+          buffer += ' ';
        }
 
-       cout << endl;
+       buffer += '\n';
+    }
+
+    std::cout << buffer << std::flush;
+ }
+
+ /*
+  * Each structure is counted with bytesUsed() (so for fixed sizes its grids are counted
+  * where they lie, in the object), and the rest of the object as "minefield other".
+  */
+ template<class Dims>
+ std::size_t basicMineField<Dims>::memoryUsage(memoryReport &report) const
+ {
+    std::size_t total = 0, inObject = 0;
+
+    const auto add = [&](const char *name, const auto &member)
+    {
+       report.add(name, bytesUsed(member));
+       total    += bytesUsed(member);
+       inObject += sizeof(member);
+    };
+
+    add("minefield exploration map",   expMap);
+    add("minefield row epochs",        expRowEpoch);
+    add("minefield mine map",          mineMap);
+    add("minefield count map",         countMap);
+    add("minefield mine list",         mineList);
+    add("minefield reveal log",        revealLog);
+    add("minefield flood fill stack",  fillStack);
+    add("minefield frontier",          frontier);
+    add("minefield frontier",          frontierPos);
+    add("minefield snapshot journal",  journal);
+    add("minefield snapshot journal",  snapshots);
+
+    report.add("minefield other", sizeof(*this) - inObject);
+
+    return total + sizeof(*this) - inObject;
+ }
+
+ /*
+  * As the constructor sizes the structures, plus a reveal log holding every square.  The
+  * frontier is not counted, as its length depends on the order of play.
+  */
+ template<class Dims>
+ std::size_t basicMineField<Dims>::estimateMemoryUsage(const int &h, const int &w, const int &n)
+ {
+    std::size_t bytes = sizeof(basicMineField);
+
+    if constexpr (std::is_same<Dims, dynamicDims>::value)
+    {
+       bytes += h * (sizeof(std::vector<signed char>) + w * sizeof(signed char)); // expMap
+       bytes += h * sizeof(unsigned);                                             // Epochs.
+       bytes += 2 * std::size_t(h + 2) * (w + 2);                         // mineMap, countMap.
     }
+
+    bytes += 16 * sizeof(frontierEntry); // Initial frontierPos.
+
+    return bytes + std::size_t(n) * sizeof(int) + std::size_t(h) * w * sizeof(square);
  }
 
 } // End namespace minesweeper.
@@ -132,32 +332,75 @@ namespace minesweeper
 namespace minesweeper
 {
 
+ /*
+  * Remove the mines in mineList from mineMap, and (if the counts are maintained per mine)
+  * their contributions to countMap.  Touches O(nMines) squares rather than the whole map.
+  */
+ template<class Dims>
+ void basicMineField<Dims>::clearMines(void)
+ {
+    const int w = getWidth() + 2;
+
+    for (const int &i: mineList)
+    {
+       mineMap[i] = 0;
+
+       if (countsPerMine())
+       {
+          for (int j = i - w; j <= i + w; j += w)
+          {
+             countMap[j - 1] = countMap[j] = countMap[j + 1] = 0;
+          }
+       }
+    }
+
+    mineList.clear();
+ }
+
  /*
   * Lay 'nMines' mines at random positions in minefield.
   */
- void mineField::layMines(void)
+ template<class Dims>
+ void basicMineField<Dims>::layMines(void)
  {
+    const int w = getWidth() + 2;
+
     int  r, c, n;
     bool mineLayed;
 
-    srand(time(NULL));
-
     // lay mines
     for (n = 0; n < getNmines(); ++n)
     {
        mineLayed = false;
        while (!mineLayed)
        {
-          r = rand() % getHeight();
-          c = rand() % getWidth();
+          r = rng() % getHeight();
+          c = rng() % getWidth();
 
           if (!squareMined(r, c))
           {
-             map[r][c] = true;
+             const int i = paddedIndex(r, c);
+
+             mineMap[i] = 1;
+             mineList.push_back(i);
              mineLayed = true;
+
+             if (countsPerMine())
+             {
+                for (int j = i - w; j <= i + w; j += w)
+                {
+                   ++countMap[j - 1]; ++countMap[j]; ++countMap[j + 1];
+                }
+                --countMap[i]; // A mine is not its own neighbour.
+             }
           }
        }
     }
+
+    if (not countsPerMine())
+    {
+       countAllMinedNbours();
+    }
 /*
     map[0][0] = 1; map[0][1] = 1; map[0][2] = 1; map[0][3] = 0; map[0][4] = 1;
     map[1][0] = 0; map[1][1] = 1; map[1][2] = 1; map[1][3] = 0; map[1][4] = 1;
@@ -167,68 +410,214 @@ namespace minesweeper
  }
 
  /*
-  * Returns the sum of the values in the eight squares surrounding (i, j).
+  * Set countMap to the number of mines surrounding each square, as a 3x3 box sum over the
+  * padded mine map less the centre square.  The horizontal sums are formed over the whole
+  * padded grid and the vertical sums row by row, so both inner loops run over contiguous
+  * bytes with no bounds tests (the border of mineMap is always clear).  The horizontal sums
+  * are kept in the thread's scratch arena.
   */
- int mineField::countMinedNbours(const square &s) const
+ template<class Dims>
+ void basicMineField<Dims>::countAllMinedNbours(void)
  {
-    assert(squareInsideMap(s));
+    const int w = getWidth() + 2, n = (getHeight() + 2) * w;
+
+    const scratchScope           scope;
+    scratchVector<unsigned char> rowSums(n);
 
-    int t = s.row - 1, tSafe = s.row >               0, // Top    is within map.
-        b = s.row + 1, bSafe = s.row < getHeight() - 1, // Bottom is within map.
-        l = s.col - 1, lSafe = s.col >               0, // Left   is within map.
-        r = s.col + 1, rSafe = s.col < getWidth()  - 1, // Right  is within map.
-        count = 0;
+    const unsigned char *m = &mineMap[0];
+    unsigned char       *h = &rowSums[0];
 
-    if (tSafe)
+    for (int i = 1; i < n - 1; ++i)
     {
-       if (lSafe) {count += squareMined(t,     l);} // Top left.
-                  {count += squareMined(t, s.col);} // Top middle.
-       if (rSafe) {count += squareMined(t,     r);} // Top right.
+       h[i] = m[i - 1] + m[i] + m[i + 1];
     }
 
-       if (lSafe) {count += squareMined(s.row, l);} // Middle left.
-       if (rSafe) {count += squareMined(s.row, r);} // Middle right.
-
-    if (bSafe)
+    for (int r = 1; r <= getHeight(); ++r)
     {
-       if (lSafe) {count += squareMined(b,     l);} // Bottom left.
-                  {count += squareMined(b, s.col);} // Bottom middle.
-       if (rSafe) {count += squareMined(b,     r);} // Bottom right.
+       const unsigned char *above = h + (r - 1) * w, *row = h + r * w, *below = h + (r + 1) * w;
+       const unsigned char *mines = m + r * w;
+       unsigned char       *count = &countMap[r * w];
+
+       for (int c = 1; c <= getWidth(); ++c)
+       {
+          count[c] = above[c] + row[c] + below[c] - mines[c];
+       }
     }
+ }
+
+ /*
+  * Explore the neighbours of each square on fillStack until it is empty.  The neighbours of
+  * a square with no surrounding mines are clear, so need not be tested.  An explicit stack
+  * is used rather than recursion, whose depth could reach the number of squares filled.
+  */
+ template<class Dims>
+ void basicMineField<Dims>::fillFromStack(void)
+ {
+    while (not fillStack.empty())
+    {
+       const square s = fillStack.back();
+       fillStack.pop_back();
+
+       const int t = std::max(s.row - 1, 0), b = std::min(s.row + 1, getHeight() - 1),
+                 l = std::max(s.col - 1, 0), r = std::min(s.col + 1, getWidth()  - 1);
 
-    return count;
+       for (int i = t; i <= b; ++i)
+       {
+          for (int j = l; j <= r; ++j)
+          {
+             if (not squareExplored(i, j) and not squareFlagged(i, j))
+             {
+                reveal(square(i, j));
+             }
+          }
+       }
+    }
  }
 
  /*
   *
   */
- void mineField::exploreNbours(const square &s)
+ template<class Dims>
+ bool basicMineField<Dims>::hasUnexploredNbour(const int &r, const int &c) const
  {
-    assert(squareInsideMap(s));
+    const int t = std::max(r - 1, 0), b = std::min(r + 1, getHeight() - 1),
+              l = std::max(c - 1, 0), rt = std::min(c + 1, getWidth() - 1);
 
-    int t = s.row - 1, tSafe = s.row >               0, // Top    is within map.
-        b = s.row + 1, bSafe = s.row < getHeight() - 1, // Bottom is within map.
-        l = s.col - 1, lSafe = s.col >               0, // Left   is within map.
-        r = s.col + 1, rSafe = s.col < getWidth()  - 1; // Right  is within map.
+    for (int i = t; i <= b; ++i)
+    {
+       for (int j = l; j <= rt; ++j)
+       {
+          if (expValue(i, j) < 0)
+          {
+             return true;
+          }
+       }
+    }
+
+    return false;
+ }
+
+ /*
+  * Update the frontier for square s having been explored: s joins it if it has unexplored
+  * neighbours, and explored neighbours of s leave it if s was their last unexplored one.
+  */
+ template<class Dims>
+ void basicMineField<Dims>::frontierExplored(const square &s)
+ {
+    const int t = std::max(s.row - 1, 0), b = std::min(s.row + 1, getHeight() - 1),
+              l = std::max(s.col - 1, 0), r = std::min(s.col + 1, getWidth()  - 1);
 
-    if (tSafe)
+    for (int i = t; i <= b; ++i)
     {
-       if (lSafe) {explore(t, l    );} // Top left.
-                  {explore(t, s.col);} // Top middle.
-       if (rSafe) {explore(t, r    );} // Top right.
+       for (int j = l; j <= r; ++j)
+       {
+          const square n(i, j);
+
+          if (i == s.row and j == s.col)
+          {
+             if (hasUnexploredNbour(i, j)) {frontierInsert(n);}
+          }
+          else if (squareOnFrontier(n) and not hasUnexploredNbour(i, j))
+          {
+             frontierErase(n);
+          }
+       }
     }
+ }
 
-       if (lSafe) {explore(s.row, l);} // Middle left.
-       if (rSafe) {explore(s.row, r);} // Middle right.
+ /*
+  * Update the frontier for square s having been returned to unexplored by popSnapshot(): s
+  * leaves it, and its explored neighbours join it.
+  */
+ template<class Dims>
+ void basicMineField<Dims>::frontierUnexplored(const square &s)
+ {
+    if (squareOnFrontier(s))
+    {
+       frontierErase(s);
+    }
 
-    if (bSafe)
+    const int t = std::max(s.row - 1, 0), b = std::min(s.row + 1, getHeight() - 1),
+              l = std::max(s.col - 1, 0), r = std::min(s.col + 1, getWidth()  - 1);
+
+    for (int i = t; i <= b; ++i)
     {
-       if (lSafe) {explore(b, l    );} // Bottom left.
-                  {explore(b, s.col);} // Bottom middle.
-       if (rSafe) {explore(b, r    );} // Bottom right.
+       for (int j = l; j <= r; ++j)
+       {
+          const square n(i, j);
+
+          if (expValue(i, j) >= 0 and not squareOnFrontier(n))
+          {
+             frontierInsert(n);
+          }
+       }
+    }
+ }
+
+ /*
+  * Double the slots in frontierPos and rehash its entries.
+  */
+ template<class Dims>
+ void basicMineField<Dims>::frontierGrow(void)
+ {
+    std::vector<frontierEntry> old(2 * frontierPos.size(), frontierEntry{-1, 0});
+    old.swap(frontierPos);
+    ++frontierBits;
+
+    for (const frontierEntry &e: old)
+    {
+       if (e.key != -1) {frontierPos[frontierSlot(e.key)] = e;}
     }
  }
 
+ /*
+  * Empty slot i of frontierPos, shifting back into the gap each later entry of the probe run
+  * that may fill it, so that no entry is left beyond an empty slot from its home.
+  */
+ template<class Dims>
+ void basicMineField<Dims>::frontierVacate(std::size_t i)
+ {
+    const std::size_t mask = frontierPos.size() - 1;
+
+    for (std::size_t j = (i + 1) & mask; frontierPos[j].key != -1; j = (j + 1) & mask)
+    {
+       // Entry j may move back to i unless its home lies cyclically in (i, j].
+       if (((j - frontierHome(frontierPos[j].key)) & mask) >= ((j - i) & mask))
+       {
+          frontierPos[i] = frontierPos[j];
+          i = j;
+       }
+    }
+
+    frontierPos[i].key = -1;
+ }
+
+ /*
+  *
+  */
+ template<class Dims>
+ typename basicMineField<Dims>::exploreDelta
+ basicMineField<Dims>::deltaSince(const std::size_t &logSize, const bool &clear) const
+ {
+    exploreDelta d;
+    d.clear    = clear;
+    d.revealed = std::span<const square>(revealLog.data() + logSize, revealLog.size() - logSize);
+
+    return d;
+ }
+
+} // End namespace minesweeper.
+
+// Explicit instantiations. ////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ template class basicMineField<dynamicDims>;
+ template class basicMineField< fixedDims< 8,  8> >;
+ template class basicMineField< fixedDims<16, 16> >;
+ template class basicMineField< fixedDims<16, 30> >;
+
 } // End namespace minesweeper.
 
 /*******************************************END*OF*FILE********************************************/
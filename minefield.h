@@ -6,7 +6,7 @@
 *
 * Project: Minesweeper Text
 *
-* Purpose: Class "mineField" definition.
+* Purpose: Class template "basicMineField" definition.
 *
 * Author: Tom McDonnell 2003
 *
@@ -17,6 +17,12 @@
 
 // Includes. ///////////////////////////////////////////////////////////////////////////////////////
 
+#include "memory.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <span>
 #include <vector>
 #include <iostream>
 #include <cassert>
@@ -42,24 +48,113 @@ namespace minesweeper
  }
 
  /*
-  *
+  * Dimension policy for boards whose size is chosen at run time.
+  * Grids are nested vectors.  Padded grids are flat vectors of (h + 2) * (w + 2) elements
+  * holding the grid surrounded by a border one square wide (row major).  Row arrays hold
+  * one element per row.
+  */
+ class dynamicDims
+ {
+  public:
+    template<class T> using grid       = std::vector< std::vector<T> >;
+    template<class T> using paddedGrid = std::vector<T>;
+    template<class T> using rowArray   = std::vector<T>;
+
+    template<class T>
+    static void resizeRows(rowArray<T> &a, const int &h) {a.resize(h);}
+
+    template<class T>
+    static void resize(grid<T> &g, const int &h, const int &w)
+    {
+       g.resize(h);
+       for (int r = 0; r < h; ++r) {g[r].resize(w);}
+    }
+
+    template<class T>
+    static void resize(paddedGrid<T> &g, const int &h, const int &w) {g.resize((h + 2) * (w + 2));}
+ };
+
+ /*
+  * Dimension policy for boards whose size is fixed at compile time.
+  * Grids are nested std::arrays, so getHeight() and getWidth() are constants
+  * and every bounds test in the neighbour functions is against a constant.
+  */
+ template<int H, int W>
+ class fixedDims
+ {
+  public:
+    template<class T> using grid       = std::array< std::array<T, W>, H >;
+    template<class T> using paddedGrid = std::array<T, (H + 2) * (W + 2)>;
+    template<class T> using rowArray   = std::array<T, H>;
+
+    template<class T>
+    static void resizeRows(rowArray<T> &, const int &h) {assert(h == H);}
+
+    template<class T>
+    static void resize(grid<T> &, const int &h, const int &w) {assert(h == H and w == W);}
+
+    template<class T>
+    static void resize(paddedGrid<T> &, const int &h, const int &w) {assert(h == H and w == W);}
+ };
+
+ /*
+  * Minefield (hidden mine map plus map of explored territory).
+  * Use typedef "mineField" for boards of any size, or "mineFieldT<H, W>" for a fixed size.
   */
- class mineField
+ template<class Dims>
+ class basicMineField
  {
   public:
+    typedef Dims dimsType;
+
     // Public function declarations / inline definitions. -------------------------------------//
 
     /** Initialisation functions. **/
 
     /* Constructor. */
-    mineField(const int &h = 8, const int &w = 8, const int &n = 10);
+    basicMineField(const int &h = 8, const int &w = 8, const int &n = 10);
 
+    /*
+     * Reset to unexplored state and lay mines in a random (or seed determined) layout.
+     * The exploration map is reset lazily (see expRowEpoch) and only the squares around the
+     * previous layout's mines are cleared, so the cost does not depend on the board size
+     * unless the board is densely mined.
+     */
     void reset(void);
+    void reset(const unsigned &seed);
+
+    /** Speculation functions. **/
+
+    /*
+     * Snapshots are recorded as an undo journal of exploration map changes, so taking one
+     * costs nothing and restoring one costs time proportional to the squares changed since.
+     * Snapshots nest.  reset() discards all snapshots.
+     */
+    void pushSnapshot(void);
+    void popSnapshot(void);
+    int  getSnapshotDepth(void) const {return snapshots.size();}
 
     /** Get functions. **/
-    int getHeight(void) const {return map.size();}
-    int getWidth(void)  const {return map[0].size();} // rely on rows being same width
+    int getHeight(void) const {return expMap.size();}
+    int getWidth(void)  const {return expMap[0].size();} // rely on rows being same width
     int getNmines(void) const {return n_mines;}
+    unsigned getSeed(void) const {return seed;} // Seed of current mine layout.
+
+    /*
+     * Squares explored since reset(), in the order explored.  Entries are only ever appended
+     * except by reset() and popSnapshot(), each of which changes getRevealLogVersion().
+     */
+    const std::vector<square> &getRevealLog(void) const {return revealLog;}
+    unsigned getRevealLogVersion(void) const {return revealLogVersion;}
+
+    /*
+     * The frontier: explored squares with at least one unexplored (or flagged) neighbour, in
+     * no particular order.  Kept up to date as squares are explored and snapshots restored,
+     * in time independent of the board size.  getFrontierVersion() changes whenever the
+     * frontier does.
+     */
+    const std::vector<square> &getFrontier(void) const {return frontier;}
+    unsigned getFrontierVersion(void) const {return frontierVersion;}
 
     /** Boolean test functions. **/
 
@@ -73,35 +168,73 @@ namespace minesweeper
 
     /* Test whether square has been flagged. */
     bool squareFlagged(const int &r, const int &c) const
-    {assert(squareInsideMap(r, c)); return expMap[r][c] == -2;}
+    {assert(squareInsideMap(r, c)); return expValue(r, c) == -2;}
     bool squareFlagged(const square &s) const {return squareFlagged(s.row, s.col);}
 
     /* Test whether square has been explored. */
     bool squareExplored(const int &r, const int &c) const
-    {assert(squareInsideMap(r, c)); return expMap[r][c] >=  0;}
+    {assert(squareInsideMap(r, c)); return expValue(r, c) >=  0;}
     bool squareExplored(const square &s) const {return squareExplored(s.row, s.col);}
 
+    /* Test whether square is on the frontier (see getFrontier()). */
+    bool squareOnFrontier(const square &s) const
+    {
+       assert(squareInsideMap(s));
+       return frontierPos[frontierSlot(paddedIndex(s.row, s.col))].key != -1;
+    }
+
+    /*
+     * Test whether square is mined.  Hidden from the player, so for checking solvers only
+     * (see "validate.h").
+     */
+    bool squareHidesMine(const square &s) const {assert(squareInsideMap(s)); return squareMined(s);}
+
     /** Counting functions. **/
 
     /* Returns the number of mines surrounding that square (use only if square explored). */
     int n_minedNbours(const int &r, const int &c) const
-    {assert(squareExplored(r, c)); return expMap[r][c];}
+    {assert(squareExplored(r, c)); return expValue(r, c);}
     int n_minedNbours(const square &s) const {return n_minedNbours(s.row, s.col);}
 
     /** Functions corresponding to actions. **/
 
     /* Flag (mark) square as being mined (To avoid accidentally uncovering it later). */
-    void flagSquare(const int &r, const int &c) {expMap[r][c] = -2;}
+    void flagSquare(const int &r, const int &c) {setExpMap(r, c, -2);}
     void flagSquare(const square &s) {flagSquare(s.row, s.col);}
 
     /*
      * Explore square (i, j).  If square is mined returns false, else returns true.
-     * If square has no surrounding mines, explores all surrounding squares recursively.
+     * If square has no surrounding mines, explores all surrounding squares, and so on.
      * If all clear squares have been explored game is won.
      */
     bool explore(const square &);
     bool explore(const int &r, const int &c) {return explore(square(r, c));}
 
+    /*
+     * Result of exploreMany() and chord().  revealed is the squares newly explored, in the
+     * order explored: the end of getRevealLog(), so valid until the exploration state next
+     * changes.  clear is false if any square to be explored was mined.
+     */
+    class exploreDelta
+    {
+     public:
+       bool                     clear;
+       std::span<const square> revealed;
+    };
+
+    /*
+     * Explore each of squares (as explore() does, the mined ones being left unexplored).
+     * The areas opened around squares with no surrounding mines are filled in one pass, so
+     * that no square is visited twice where they overlap.
+     */
+    exploreDelta exploreMany(const std::span<const square> &squares);
+
+    /*
+     * Explore every unflagged neighbour of explored square s, if as many of its neighbours
+     * are flagged as surround it with mines (otherwise explore nothing).
+     */
+    exploreDelta chord(const square &s);
+
     /** Misc. functions. **/
 
     /*
@@ -109,34 +242,223 @@ namespace minesweeper
      */
     void printMap(void) const;
 
+    /* Add the bytes used by each structure of the minefield to report, and return their sum. */
+    std::size_t memoryUsage(memoryReport &report) const;
+    std::size_t memoryUsage(void) const {memoryReport r; return memoryUsage(r);}
+
+    /*
+     * Return memoryUsage() of a minefield of the given size after a game in which every clear
+     * square is explored, without constructing one.
+     */
+    static std::size_t estimateMemoryUsage(const int &h, const int &w, const int &n);
+
   private:
     // Private function declarations / inline definitions. /////////////////////////////////////////
 
-    bool squareMined(const int &r, const int &c) const {return map[r][c];}
+    bool squareMined(const int &r, const int &c) const {return mineMap[paddedIndex(r, c)];}
     bool squareMined(const square &s) const {return squareMined(s.row, s.col);}
 
-    int countMinedNbours(const square &) const;
+    /* Index of square (r, c) in a padded grid. */
+    int paddedIndex(const int &r, const int &c) const {return (r + 1) * (getWidth() + 2) + c + 1;}
 
+    /*
+     * Return true if countMap is maintained mine by mine by clearMines() and layMines()
+     * (cheaper for sparsely mined boards) rather than recomputed by countAllMinedNbours().
+     */
+    bool countsPerMine(void) const
+    {return 32 * getNmines() < (getHeight() + 2) * (getWidth() + 2);}
+
+    void clearMines(void);
     void layMines(void);
-    void exploreNbours(const square &);
+    void countAllMinedNbours(void);
+
+    /*
+     * Explore unexplored and unflagged clear square s, queueing it on fillStack if it has no
+     * surrounding mines.
+     */
+    void reveal(const square &s)
+    {
+       ++squaresExplored;
+       revealLog.push_back(s);
+
+       setExpMap(s.row, s.col, countMap[paddedIndex(s.row, s.col)]);
+
+       if (expMap[s.row][s.col] == 0) {fillStack.push_back(s);}
+
+       frontierExplored(s);
+    }
+
+    bool hasUnexploredNbour(const int &r, const int &c) const;
+    void frontierExplored(const square &s);
+    void frontierUnexplored(const square &s);
+
+    /* Home slot in frontierPos of padded grid index key (Fibonacci hashing). */
+    std::size_t frontierHome(const int &key) const
+    {return (unsigned(key) * 2654435769u) >> (32 - frontierBits);}
+
+    /* Slot in frontierPos holding key, or the empty slot where key would go. */
+    std::size_t frontierSlot(const int &key) const
+    {
+       const std::size_t mask = frontierPos.size() - 1;
+       std::size_t       i    = frontierHome(key);
+
+       while (frontierPos[i].key != key and frontierPos[i].key != -1) {i = (i + 1) & mask;}
+
+       return i;
+    }
+
+    void frontierGrow(void);
+    void frontierVacate(std::size_t i);
+
+    /* Add s to or remove s from the frontier (a sparse set: see frontierPos). */
+    void frontierInsert(const square &s)
+    {
+       if (2 * (frontier.size() + 1) > frontierPos.size()) {frontierGrow();}
+
+       const int key = paddedIndex(s.row, s.col);
+       frontierPos[frontierSlot(key)] = frontierEntry{key, int(frontier.size())};
+       frontier.push_back(s);
+       ++frontierVersion;
+    }
+    void frontierErase(const square &s)
+    {
+       const std::size_t slot = frontierSlot(paddedIndex(s.row, s.col));
+       const int         i    = frontierPos[slot].pos;
+       frontier[i] = frontier.back();
+       frontierPos[frontierSlot(paddedIndex(frontier[i].row, frontier[i].col))].pos = i;
+       frontier.pop_back();
+       frontierVacate(slot);
+       ++frontierVersion;
+    }
+
+    void fillFromStack(void);
+    exploreDelta deltaSince(const std::size_t &logSize, const bool &clear) const;
+
+    /* Return expMap[r][c], reading rows not written since the last reset() as unexplored. */
+    int expValue(const int &r, const int &c) const
+    {return (expRowEpoch[r] == epoch)? expMap[r][c]: -1;}
+
+    /* Set expMap[r][c], recording the old value in the journal if a snapshot is active. */
+    void setExpMap(const int &r, const int &c, const int &v)
+    {
+       if (expRowEpoch[r] != epoch)
+       {
+          std::fill(expMap[r].begin(), expMap[r].end(), -1); // Unexplored.
+          expRowEpoch[r] = epoch;
+       }
+
+       if (not snapshots.empty()) {journal.push_back(expMapChange(r, c, expMap[r][c]));}
+       expMap[r][c] = v;
+    }
+
+    // Private class definitions. //////////////////////////////////////////////////////////////////
+
+    class expMapChange
+    {
+     public:
+       expMapChange(const int &_row, const int &_col, const int &_oldValue)
+       : row(_row), col(_col), oldValue(_oldValue)
+       {}
+
+       int row, col, oldValue;
+    };
+
+    class snapshotMark
+    {
+     public:
+       snapshotMark(const int &_journalSize, const int &_squaresExplored)
+       : journalSize(_journalSize), squaresExplored(_squaresExplored)
+       {}
+
+       int journalSize, squaresExplored;
+    };
 
     // Private constant & variable declarations. ///////////////////////////////////////////////////
 
     const int n_mines;                      // Total number of mines in mineField.
 
-    std::vector< std::vector<int> > expMap; // Map of explored territory.
-                                            // (expMap[r][c] = [0 - 8] If explored,
-                                            //                         meaning that many mines
-                                            //                         lie in surrounding squares.
-                                            //                 -1 If unexplored
-                                            //                 -2 If flagged
+    typename Dims::template grid<signed char> expMap; // Map of explored territory.
+                                                      // (expMap[r][c] = [0 - 8] If explored,
+                                                      //                 meaning that many mines
+                                                      //                 lie in surrounding
+                                                      //                 squares.
+                                                      //                 -1 If unexplored
+                                                      //                 -2 If flagged
+                                                      //  Only valid for rows r where
+                                                      //  expRowEpoch[r] == epoch.)
+
+    typename Dims::template rowArray<unsigned> expRowEpoch; // Epoch in which each row of
+                                                            // expMap was last written.
+    unsigned epoch;                                         // Incremented by reset().
+
+    typename Dims::template paddedGrid<unsigned char> mineMap;  // Map of minefield (padded)
+                                                                // (1 if square is mined,
+                                                                //  0 if square is clear).
 
-    std::vector< std::vector<bool> > map;   // Map of minefield (if square is mined true,
-                                            //                   if square is clear false)
+    typename Dims::template paddedGrid<unsigned char> countMap; // Number of mines surrounding
+                                                                // each square (padded), set by
+                                                                // layMines().
+
+    std::vector<int> mineList; // Padded grid indices of mined squares.
 
     int squaresExplored;
+
+    std::vector<square> revealLog;        // Squares explored since reset() in order explored.
+    unsigned            revealLogVersion; // Changed whenever revealLog is truncated.
+
+    std::vector<square> fillStack; // Explored squares with no surrounding mines whose
+                                   // neighbours are still to be explored (empty between
+                                   // calls).
+
+    struct frontierEntry {int key; int pos;}; // Padded grid index of a square on the frontier
+                                              // and its position in frontier (key -1: empty).
+
+    std::vector<square>        frontier;        // See getFrontier().
+    std::vector<frontierEntry> frontierPos;     // Open addressing hash table (linear probing,
+                                                // 2^frontierBits slots, at most half full)
+                                                // locating each square on the frontier, so
+                                                // its size follows the frontier, not the
+                                                // board.
+    int                        frontierBits;
+    unsigned                   frontierVersion; // Changed whenever frontier changes.
+
+    unsigned         seed; // Seed of current mine layout.
+    std::minstd_rand rng;  // Generator used to lay mines (per minefield, so seeded
+                           // layouts are reproducible when many minefields are in use).
+
+    std::vector<expMapChange> journal;   // Undo journal of expMap changes (only kept while
+                                         // at least one snapshot is active).
+    std::vector<snapshotMark> snapshots; // Stack of active snapshots.
  };
 
+ // Typedefs and explicit instantiations. ////////////////////////////////////////////////////////
+
+ typedef basicMineField<dynamicDims> mineField;
+
+ template<int H, int W> using mineFieldT = basicMineField< fixedDims<H, W> >;
+
+ // Classic beginner, intermediate and expert sizes (defined in "minefield.cpp").
+ extern template class basicMineField<dynamicDims>;
+ extern template class basicMineField< fixedDims< 8,  8> >;
+ extern template class basicMineField< fixedDims<16, 16> >;
+ extern template class basicMineField< fixedDims<16, 30> >;
+
+ /*
+  * Call f(fieldType<F>()) where F is the fixed size mineFieldT<h, w> if one is
+  * instantiated for those dimensions, or mineField otherwise, and return the result.
+  */
+ template<class F> class fieldType {public: typedef F type;};
+
+ template<class Func>
+ auto dispatchFieldType(const int &h, const int &w, Func f)
+ {
+    if (h ==  8 and w ==  8) {return f(fieldType< mineFieldT< 8,  8> >());}
+    if (h == 16 and w == 16) {return f(fieldType< mineFieldT<16, 16> >());}
+    if (h == 16 and w == 30) {return f(fieldType< mineFieldT<16, 30> >());}
+
+    return f(fieldType<mineField>());
+ }
+
 } // End namespace minesweeper.
 
 #endif
@@ -17,10 +17,15 @@
 
 #include "mineprob.h"
 #include "minefield.h"
+#include "enumerate.h"
+#include "modelcount.h"
+#include "arena.h"
 
 #include <iostream>
+#include <sstream>
 #include <bitset>
 #include <algorithm>
+#include <deque>
 
 #include <cassert>
 
@@ -28,6 +33,7 @@
 
 namespace
 {
+ using namespace minesweeper;
 
  template<class T>
  T minimum(T a, T b, T c) {return std::min(std::min(a, b), c);}
@@ -35,9 +41,40 @@ namespace
  template<class T>
  T maximum(T a, T b, T c) {return std::max(std::max(a, b), c);}
 
+ // Partial assignments the enumeration of one frontier component may visit.
+ const double maxEnumerated = 1 << 22;
+
+ /*
+  * The unknown neighbours (numbered in row major order) of an explored square, and the number
+  * of mines among them.
+  */
+ class frontierConstraint
+ {
+  public:
+    int n_cells;
+    int cells[8];
+    int count;
+ };
+
+ /* Order of squares in a scan of the map. */
+ bool rowMajorLess(const square &a, const square &b)
+ {return a.row < b.row or (a.row == b.row and a.col < b.col);}
+
+ /* Union-find root of cell i (with path halving). */
+ int findRoot(scratchVector<int> &parent, int i)
+ {
+    while (parent[i] != i)
+    {
+       parent[i] = parent[parent[i]];
+       i         = parent[i];
+    }
+
+    return i;
+ }
+
 }
 
-// Class mineFieldProbMap public member functions. /////////////////////////////////////////////////
+// Class template basicMineFieldProbMap public member functions. ///////////////////////////////////
 
 namespace minesweeper
 {
@@ -45,87 +82,438 @@ namespace minesweeper
  /*
   * Constructor.
   */
- mineFieldProbMap::mineFieldProbMap(const mineField *_Mptr)
- : Mptr(_Mptr)
+ template<class Field>
+ basicMineFieldProbMap<Field>::basicMineFieldProbMap(const Field *_Mptr)
+ : Mptr(_Mptr), verbose(true), epoch(0), revealCursor(0), revealLogVersion(0),
+   cacheGeneration(0)
  {
-    // Resize rows.
-    probMap.resize(Mptr->getHeight());
+    Field::dimsType::resize(probMap, Mptr->getHeight(), Mptr->getWidth());
+    Field::dimsType::resizeRows(rowEpoch, Mptr->getHeight());
 
-    int r, c;
-    for (r = 0; r < Mptr->getHeight(); ++r)
-    {
-       // Resize columns.
-       probMap[r].resize(Mptr->getWidth());
+    std::fill(rowEpoch.begin(), rowEpoch.end(), 0);
 
-       // Initialise rows.
-       for (c = 0; c < Mptr->getWidth(); ++c)
-       {
-          probMap[r][c] = -1.0; // Unmined.
-       }
-    }
+    reset();
  }
 
  /*
   * Update the probability map to take into account
   * knowledge from all squares that have been explored.
   */
- bool mineFieldProbMap::update(void)
+ template<class Field>
+ bool basicMineFieldProbMap<Field>::update(void)
+ {
+    bool probMapChanged = false;
+
+    runUpdate(updateLimits(), probMapChanged);
+
+    return probMapChanged;
+ }
+
+ /*
+  * Update the probability map as update() does, stopping early if the deadline passes or
+  * *cancelFlag becomes true.
+  */
+ template<class Field>
+ updateStatus basicMineFieldProbMap<Field>::update
+ (
+    const std::chrono::steady_clock::time_point &deadline, const std::atomic<bool> *cancelFlag,
+    bool *probMapChanged
+ )
+ {
+    bool changed = false;
+
+    const updateStatus status = runUpdate(updateLimits(deadline, cancelFlag), changed);
+
+    if (probMapChanged != 0) {*probMapChanged = changed;}
+
+    return status;
+ }
+
+ /*
+  * Set the probability of each unknown square being mined by exact counting.
+  */
+ template<class Field>
+ bool basicMineFieldProbMap<Field>::updateProbabilities(const int &n_mines)
+ {
+    bool learned = false;
+
+    runUpdateProbabilities(n_mines, updateLimits(), learned);
+
+    return learned;
+ }
+
+ /*
+  * As updateProbabilities(), stopping early if the deadline passes or *cancelFlag becomes
+  * true.
+  */
+ template<class Field>
+ updateStatus basicMineFieldProbMap<Field>::updateProbabilities
+ (
+    const int &n_mines, const std::chrono::steady_clock::time_point &deadline,
+    const std::atomic<bool> *cancelFlag, bool *learned
+ )
+ {
+    bool l = false;
+
+    const updateStatus status =
+    runUpdateProbabilities(n_mines, updateLimits(deadline, cancelFlag), l);
+
+    if (learned != 0) {*learned = l;}
+
+    return status;
+ }
+
+ /*
+  * Probabilities are only recorded once every component has been counted, so stopping early
+  * leaves the map as it was.
+  */
+ template<class Field>
+ updateStatus basicMineFieldProbMap<Field>::runUpdateProbabilities
+ (
+    const int &n_mines, const updateLimits &limits, bool &learned
+ )
  {
     using std::cout;
     using std::endl;
 
-    setProbOfExploredSquaresToZero();
+    learned = false;
+
+    const int height = Mptr->getHeight(), width = Mptr->getWidth();
+
+    if (verbose) {cout << "Calculating probabilities of unknown squares." << endl;}
+
+    if (setProbOfExploredSquaresToZero())
+    {
+       resume.restart();
+    }
+
+    // All working data is taken from the thread's scratch arena, and released on return.
+    const scratchScope scope;
+
+    const long n_unknown = long(height) * width - n_known;
 
-    cout << "Updating probability map." << endl;
+    // Number the unknown neighbours of the frontier in row major order, so that the cells of
+    // each component are numbered as the component cache expects whatever the order the
+    // frontier is kept in, then join those constrained together.
+    const std::vector<square> &frontier = Mptr->getFrontier();
 
-    bool success, probMapChanged = false;
+    scratchVector<square>             cells;
+    scratchVector<frontierConstraint> constraints;
+    square                            t;
 
-    do
+    for (const square &f: frontier)
     {
-       do
+       for (t.row = f.row - 1; t.row <= f.row + 1; ++t.row)
        {
-          cout << " Applying simple tests." << endl;
-          success = applySimpleTestsToAllSquares();
+          for (t.col = f.col - 1; t.col <= f.col + 1; ++t.col)
+          {
+             if (Mptr->squareInsideMap(t) and not squareKnown(t)) {cells.push_back(t);}
+          }
+       }
+    }
+
+    std::sort(cells.begin(), cells.end(), rowMajorLess);
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    scratchVector<int> parent(cells.size());
 
-          if (success)
+    for (int i = 0; i < int(cells.size()); ++i) {parent[i] = i;}
+
+    for (const square &f: frontier)
+    {
+       frontierConstraint c;
+       c.n_cells = 0;
+
+       for (t.row = f.row - 1; t.row <= f.row + 1; ++t.row)
+       {
+          for (t.col = f.col - 1; t.col <= f.col + 1; ++t.col)
           {
-             probMapChanged = true; // a simple test on at least one square was successful
+             if (Mptr->squareInsideMap(t) and not squareKnown(t))
+             {
+                c.cells[c.n_cells++] =
+                int(std::lower_bound(cells.begin(), cells.end(), t, rowMajorLess) - cells.begin());
+             }
           }
        }
-       while (success);
 
-       cout << " Applying tests involving 1 other square." << endl;
-       success = applyComplexTestsUntilSuccess(1);
+       c.count = n_unknownMinedNbours(f);
 
-       if (not success)
+       if (c.count < 0 or c.count > c.n_cells)
        {
-          cout << " Applying tests involving 2 other squares." << endl;
-          success = applyComplexTestsUntilSuccess(2);
+          return updateComplete; // Inconsistent.
        }
 
-       if (not success)
+       if (c.n_cells > 0)
        {
-          cout << " Applying tests involving 3 other squares." << endl;
-          success = applyComplexTestsUntilSuccess(3);
+          for (int k = 1; k < c.n_cells; ++k)
+          {
+             parent[findRoot(parent, c.cells[k])] = findRoot(parent, c.cells[0]);
+          }
+
+          constraints.push_back(c);
        }
+    }
 
-       if (success)
+    const int n_remaining = n_mines - n_knownMined;
+
+    // Gather the cells and constraints of each component.
+    scratchVector<int>                                  component(cells.size(), -1);
+    scratchVector<int>                                  position(cells.size());
+    scratchVector< scratchVector<int> >                 componentCells;
+    scratchVector< scratchVector<componentConstraint> > componentConstraints;
+
+    for (int i = 0; i < int(cells.size()); ++i)
+    {
+       int &j = component[findRoot(parent, i)];
+
+       if (j == -1)
        {
-          probMapChanged = true; // a higher order test on one square was successful
+          j = int(componentCells.size());
+          componentCells.resize(j + 1);
        }
+
+       component[i] = j;
+       position[i]  = int(componentCells[j].size());
+       componentCells[j].push_back(i);
     }
-    while (success);
 
-    return probMapChanged;
-}
+    componentConstraints.resize(componentCells.size());
+
+    // (Masks are only used for components of at most 64 cells.)
+
+    for (const frontierConstraint &c: constraints)
+    {
+       componentConstraint cc(0, c.count);
+
+       for (int k = 0; k < c.n_cells; ++k)
+       {
+          if (position[c.cells[k]] < 64) {cc.mask |= uint64_t(1) << position[c.cells[k]];}
+       }
+
+       componentConstraints[component[c.cells[0]]].push_back(cc);
+    }
+
+    // Enumerate each component, reusing the counts of components seen by the last two
+    // calls.  Those too large are counted with the interior.
+    typedef std::deque< componentCacheEntry, scratchAllocator<componentCacheEntry> > overflowList;
+
+    overflowList                           overflow;
+    scratchVector<const componentCounts *> enumerated;
+    scratchVector<int>                     enumeratedIndex(componentCells.size(), -1);
+    long                                   n_interior = n_unknown - long(cells.size());
+    int                                    n_enumerated = 0;
+
+    ++cacheGeneration;
+
+    for (int j = 0; j < int(componentCells.size()); ++j)
+    {
+       const int n = int(componentCells[j].size());
+
+       if (n > 64)
+       {
+          n_interior += n;
+          continue;
+       }
+
+       const updateStatus status = limits.stopReason();
+
+       if (status != updateComplete)
+       {
+          return status;
+       }
+
+       scratchVector<componentConstraint> &key = componentConstraints[j];
+
+       std::sort(key.begin(), key.end());
+       key.erase(std::unique(key.begin(), key.end()), key.end());
+
+       const componentConstraint *begin = key.data(), *end = key.data() + key.size();
+       const int                  maxMines = std::min(n_remaining, n);
+       const uint64_t             hash = componentCacheEntry::hash(n, maxMines, begin, end);
+
+       typename componentCacheMap::iterator i = componentCache.find(hash);
+       componentCacheEntry                 *entry;
+
+       if (i != componentCache.end() and i->second.sameComponent(n, maxMines, begin, end))
+       {
+          entry = &i->second;
+       }
+       else
+       {
+          if (i != componentCache.end())
+          {
+             // The hash is taken.  Replace the entry unless this call has used it.
+             entry = (i->second.generation == cacheGeneration)? &overflow.emplace_back():
+                                                                &i->second;
+          }
+          else
+          {
+             entry = &newCacheEntry(hash);
+          }
+
+          entry->setKey(n, maxMines, begin, end);
+          entry->complete = enumerateComponent
+          (
+             n, entry->constraints, maxMines, entry->counts, maxEnumerated, limits.getDeadline()
+          );
+          ++n_enumerated;
+
+          if (entry->counts.deadlineReached)
+          {
+             entry->n_cells = -1; // So that the incomplete counts are never matched.
+             return updateDeadlineReached;
+          }
+       }
+
+       entry->generation = cacheGeneration;
+
+       if (entry->complete)
+       {
+          enumeratedIndex[j] = int(enumerated.size());
+          enumerated.push_back(&entry->counts);
+       }
+       else
+       {
+          n_interior += n;
+       }
+    }
+
+    // Entries not seen by this call are kept as spares, and those not seen by the last are
+    // removed.
+    spareEntries.clear();
+
+    typename componentCacheMap::iterator i = componentCache.begin();
+
+    while (i != componentCache.end())
+    {
+       const unsigned age = cacheGeneration - i->second.generation;
+
+       if (age > 1) {i = componentCache.erase(i); continue;}
+       if (age > 0) {spareEntries.push_back(i->first);}
+       ++i;
+    }
+
+    if (verbose)
+    {
+       cout << " Enumerated " << n_enumerated << " of " << componentCells.size()
+            << " frontier components (others cached)." << endl;
+    }
+
+    scratchVector< scratchVector<double> > probs;
+    double                                 interiorProb;
+
+    if (not weightComponents(enumerated, n_interior, n_remaining, probs, interiorProb))
+    {
+       return updateComplete;
+    }
+
+    // Record the probabilities.  Those of the interior are only written if known, as
+    // squares not written since reset() read as unconstrainedProb.
+
+    for (int i = 0; i < int(cells.size()); ++i)
+    {
+       const int    j = enumeratedIndex[component[i]];
+       const double p = (j == -1)? interiorProb: probs[j][position[i]];
+
+       learned = learned or p == 0.0 or p == 1.0;
+       setProbMined(cells[i], p);
+    }
+
+    if (n_unknown > long(cells.size()))
+    {
+       if (interiorProb == 0.0 or interiorProb == 1.0)
+       {
+          square s;
+          for (s.row = 0; s.row < height; ++s.row)
+          {
+             for (s.col = 0; s.col < width; ++s.col)
+             {
+                if (not probSet(s)) {setProbMined(s, interiorProb);}
+             }
+          }
+
+          learned = true;
+       }
+
+       unconstrainedProb = interiorProb;
+    }
+
+    if (learned)
+    {
+       resume.restart(); // Tests may now succeed that did not before.
+    }
+
+    return updateComplete;
+ }
 
  /*
-  * Print the probability map to the screen as text.
+  * Restore the probability map to its state at the time of the most recent pushSnapshot().
   */
- void mineFieldProbMap::printProbMap(void) const
+ template<class Field>
+ void basicMineFieldProbMap<Field>::popSnapshot(snapshotDelta *delta)
  {
-    using std::cout;
-    using std::endl;
+    assert(not snapshots.empty());
+
+    const snapshotMark &mark = snapshots.back();
+
+    if (delta != 0)
+    {
+       delta->probs.clear();
+       delta->maxTestOrder      = maxTestOrder;
+       delta->unconstrainedProb = unconstrainedProb;
+    }
+
+    // Undo changes in reverse order (rows changed since the snapshot are all current).
+    while (int(journal.size()) > mark.journalSize)
+    {
+       const probMapChange &change = journal.back();
+       double              &prob   = probMap[change.s.row][change.s.col];
+
+       if (delta != 0) {delta->probs.push_back(std::make_pair(change.s, prob));}
+
+       prob = change.oldProb;
+       journal.pop_back();
+    }
+
+    // Changes are to be made again in the order they were first made.
+    if (delta != 0) {std::reverse(delta->probs.begin(), delta->probs.end());}
+
+    revealCursor      = mark.revealCursor;
+    n_known           = mark.n_known;
+    n_knownMined      = mark.n_knownMined;
+    unconstrainedProb = mark.unconstrainedProb;
+    resume.restart();
+
+    snapshots.pop_back();
+ }
+
+ /*
+  * Make the changes recorded by popSnapshot() in delta.  Squares explored since the snapshot
+  * are not taken as applied until the next update(), which finds them already clear.
+  */
+ template<class Field>
+ void basicMineFieldProbMap<Field>::applySnapshotDelta(const snapshotDelta &delta)
+ {
+    for (const std::pair<square, double> &p: delta.probs)
+    {
+       setProbMined(p.first, p.second);
+    }
+
+    maxTestOrder      = std::max(maxTestOrder, delta.maxTestOrder);
+    unconstrainedProb = delta.unconstrainedProb;
+    resume.restart();
+ }
+
+ /*
+  * Print the probability map to the screen as text.  The map is built in a buffer (using
+  * the formatting of std::cout) and written at once.
+  */
+ template<class Field>
+ void basicMineFieldProbMap<Field>::printProbMap(void) const
+ {
+    std::ostringstream buffer;
+
+    buffer.copyfmt(std::cout);
 
     square s;
 
@@ -133,19 +521,186 @@ namespace minesweeper
     {
        for (s.col = 0; s.col < Mptr->getWidth(); ++s.col)
        {
-          if (!probKnown(s)) {cout << "* ";                  }
-          else               {cout << getProbMined(s) << " ";}
+          if (!probKnown(s)) {buffer << "* ";                  }
+          else               {buffer << getProbMined(s) << " ";}
+       }
+
+       buffer << '\n';
+    }
+
+    buffer << '\n';
+
+    std::cout << buffer.str() << std::flush;
+ }
+
+ /*
+  * As basicMineField::memoryUsage().  Cache entries are counted with the usual node layout
+  * of std::unordered_map (the next pointer and cached hash besides the value).
+  */
+ template<class Field>
+ std::size_t basicMineFieldProbMap<Field>::memoryUsage(memoryReport &report) const
+ {
+    std::size_t total = 0, inObject = 0;
+
+    const auto add = [&](const char *name, const auto &member)
+    {
+       report.add(name, bytesUsed(member));
+       total    += bytesUsed(member);
+       inObject += sizeof(member);
+    };
+
+    add("solver probability map",  probMap);
+    add("solver row epochs",       rowEpoch);
+    add("solver snapshot journal", journal);
+    add("solver snapshot journal", snapshots);
+    add("solver component cache",  spareEntries);
+
+    std::size_t cache = sizeof(componentCache) + componentCache.bucket_count() * sizeof(void *);
+
+    for (const typename componentCacheMap::value_type &e: componentCache)
+    {
+       cache += sizeof(e) + 2 * sizeof(void *) + heapBytes(e.second.constraints) +
+                heapBytes(e.second.counts.n_solutions) + heapBytes(e.second.counts.n_mined);
+    }
+
+    report.add("solver component cache", cache);
+    total    += cache;
+    inObject += sizeof(componentCache);
+
+    report.add("solver other", sizeof(*this) - inObject);
+
+    return total + sizeof(*this) - inObject;
+ }
+
+ /*
+  * As the constructor sizes the structures.
+  */
+ template<class Field>
+ std::size_t basicMineFieldProbMap<Field>::estimateMemoryUsage(const int &h, const int &w)
+ {
+    std::size_t bytes = sizeof(basicMineFieldProbMap);
+
+    if constexpr (std::is_same<typename Field::dimsType, dynamicDims>::value)
+    {
+       bytes += h * (sizeof(std::vector<double>) + w * sizeof(double) + sizeof(unsigned));
+    }
+
+    return bytes;
+ }
+
+ /*
+  * The working data of updateProbabilities() takes about 30 bytes per square of the frontier
+  * (at most the whole board), and the arena's blocks may be twice what was used.
+  */
+ template<class Field>
+ std::size_t basicMineFieldProbMap<Field>::estimateScratchUsage(const int &h, const int &w)
+ {
+    const std::size_t bytesPerSquare = 64;
+
+    return std::min<std::size_t>
+    (
+       scratchArena::maxRetained, scratchArena::initialSize + bytesPerSquare * h * w
+    );
+ }
+
+} // End namespace minesweeper.
+
+// Class template basicMineFieldProbMap private class definitions. /////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Deadline and cancellation flag for an interruptible update().  The clock is read only
+  * every checkInterval calls to stopReason() as reading it costs as much as a simple test.
+  */
+ template<class Field>
+ class basicMineFieldProbMap<Field>::updateLimits
+ {
+  public:
+    enum {checkInterval = 16};
+
+    updateLimits(void) : limited(false), cancelFlag(0), n_untilCheck(0) {}
+
+    updateLimits
+    (
+       const std::chrono::steady_clock::time_point &_deadline,
+       const std::atomic<bool> *_cancelFlag
+    )
+    : limited(true), deadline(_deadline), cancelFlag(_cancelFlag), n_untilCheck(0)
+    {}
+
+    /* Return the deadline (the latest time point if there is none). */
+    std::chrono::steady_clock::time_point getDeadline(void) const
+    {return (limited)? deadline: std::chrono::steady_clock::time_point::max();}
+
+    /* Return updateComplete if the update may continue, otherwise the reason to stop. */
+    updateStatus stopReason(void) const
+    {
+       if (not limited)
+       {
+          return updateComplete;
+       }
+
+       if (cancelFlag != 0 and cancelFlag->load(std::memory_order_relaxed))
+       {
+          return updateCancelled;
+       }
+
+       if (n_untilCheck-- == 0)
+       {
+          n_untilCheck = checkInterval - 1;
+
+          if (std::chrono::steady_clock::now() >= deadline)
+          {
+             n_untilCheck = 0; // So that later calls also stop.
+             return updateDeadlineReached;
+          }
        }
 
-       cout << endl;
+       return updateComplete;
     }
 
-    cout << endl;
+  private:
+    bool                                  limited;
+    std::chrono::steady_clock::time_point deadline;
+    const std::atomic<bool>              *cancelFlag;
+    mutable int                           n_untilCheck;
+ };
+
+
+ /*
+  * Hash of the key, mixing each word as splitmix64 does.
+  */
+ template<class Field>
+ uint64_t basicMineFieldProbMap<Field>::componentCacheEntry::hash
+ (
+    const int &n_cells, const int &maxMines,
+    const componentConstraint *begin, const componentConstraint *end
+ )
+ {
+    uint64_t h = uint64_t(n_cells) << 32 | uint32_t(maxMines);
+
+    const auto mix = [&h](const uint64_t &w)
+    {
+       h ^= w + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+       h  = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+       h  = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+       h ^= h >> 31;
+    };
+
+    for (const componentConstraint *c = begin; c != end; ++c)
+    {
+       mix(c->mask);
+       mix(uint64_t(c->count));
+    }
+
+    return h;
  }
 
 } // End namespace minesweeper.
 
-// Class mineFieldProbMap private function definitions. ////////////////////////////////////////////
+// Class template basicMineFieldProbMap private function definitions. //////////////////////////////
 
 namespace minesweeper
 {
@@ -155,7 +710,8 @@ namespace minesweeper
  /*
   * Return the number of nieghbours s that are known to be mined.
   */
- int mineFieldProbMap::n_knownMinedNbours(const square &s) const
+ template<class Field>
+ int basicMineFieldProbMap<Field>::n_knownMinedNbours(const square &s) const
  {
     assert(Mptr->squareExplored(s));
 
@@ -188,7 +744,8 @@ namespace minesweeper
  /*
   * Return the number of neighbours of s that are unknown (NOTE: unknown not unexplored).
   */
- int mineFieldProbMap::n_unknownNbours(const square &s) const
+ template<class Field>
+ int basicMineFieldProbMap<Field>::n_unknownNbours(const square &s) const
  {
     assert(Mptr->squareExplored(s));
 
@@ -227,7 +784,8 @@ namespace minesweeper
   * This function exists for efficiency reasons.
   * Update the probability map if anything is learned.
   */
- bool mineFieldProbMap::applySimpleTests(const square &s)
+ template<class Field>
+ bool basicMineFieldProbMap<Field>::applySimpleTests(const square &s)
  {
     assert(Mptr->squareExplored(s));
 
@@ -236,7 +794,7 @@ namespace minesweeper
     // Condition for detecting mined squares.
     if (n_unkMinedNbs == n_unknownNbours(s))
     {
-       std::cout << "  Success at " << s << "." << std::endl;
+       if (verbose) {std::cout << "  Success at " << s << "." << std::endl;}
        setProbsOfUnknownNbours(s, 1.0);
        return true;
     }
@@ -244,7 +802,7 @@ namespace minesweeper
     // Condition for detecting clear squares.
     if (n_unkMinedNbs == 0)
     {
-       std::cout << "  Success at " << s << "." << std::endl;
+       if (verbose) {std::cout << "  Success at " << s << "." << std::endl;}
        setProbsOfUnknownNbours(s, 0.0);
        return true;
     }
@@ -253,29 +811,103 @@ namespace minesweeper
  }
 
  /*
-  *
+  * Apply the tests in increasing order of complexity, returning to the simple tests after
+  * any success, until no test succeeds or a limit is reached.  Continues from (and on
+  * stopping early records) the position in resume.  Sets probMapChanged if anything was
+  * learned.
   */
- bool mineFieldProbMap::applySimpleTestsToAllSquares(void)
+ template<class Field>
+ updateStatus basicMineFieldProbMap<Field>::runUpdate
+ (
+    const updateLimits &limits, bool &probMapChanged
+ )
  {
-    bool probMapChanged = false;
-    square s;
+    using std::cout;
+    using std::endl;
 
-    // For each square in the mineField...
-    for (s.row = 0; s.row < Mptr->getHeight(); ++s.row)
+    if (setProbOfExploredSquaresToZero())
     {
-       for (s.col = 0; s.col < Mptr->getWidth(); ++s.col)
+       resume.restart(); // Earlier tests may now succeed.
+    }
+
+    if (verbose and resume.atStart()) {cout << "Updating probability map." << endl;}
+
+    for (;;)
+    {
+       bool success = false;
+       updateStatus status;
+
+       if (resume.phase == 0)
        {
-          if (Mptr->squareExplored(s) and n_unknownNbours(s))
+          if (verbose) {cout << " Applying simple tests." << endl;}
+          status = applySimpleTestsToAllSquares(limits, success);
+       }
+       else
+       {
+          if (verbose)
           {
-             if (applySimpleTests(s))
-             {
-                probMapChanged = true;
-             }
+             cout << " Applying tests involving " << resume.phase << " other square"
+                  << ((resume.phase == 1)? ".": "s.") << endl;
           }
+          status = applyComplexTestsUntilSuccess(resume.phase, limits, success);
+       }
+
+       if (success)
+       {
+          probMapChanged = true; // a test on at least one square was successful
+          maxTestOrder   = std::max(maxTestOrder, resume.phase);
+       }
+
+       if (status != updateComplete)
+       {
+          return status;
        }
+
+       // The sweep finished.  Repeat the simple tests until they fail, and return to them
+       // whenever a higher order test succeeds.
+       if      (success          ) {resume.restart();                       }
+       else if (resume.phase == 3) {resume.restart(); return updateComplete;}
+       else                        {++resume.phase; resume.pos = 0;           }
     }
+ }
 
-    return probMapChanged;
+ /*
+  * Apply the simple tests to each square of the frontier from resume.pos to the end.  Sets
+  * success if any test succeeded.  Returns updateComplete if the end of the frontier was
+  * reached, otherwise the reason for stopping (resume.pos is then the next square to test).
+  */
+ template<class Field>
+ updateStatus basicMineFieldProbMap<Field>::applySimpleTestsToAllSquares
+ (
+    const updateLimits &limits, bool &success
+ )
+ {
+    const std::vector<square> &frontier = Mptr->getFrontier();
+
+    // For each remaining square of the frontier (the tests do not change the minefield)...
+    for (int &i = sweepPos(); i < int(frontier.size()); ++i)
+    {
+       const square &s = frontier[i];
+
+       if (n_unknownNbours(s))
+       {
+          const updateStatus status = limits.stopReason();
+
+          if (status != updateComplete)
+          {
+             success = success or resume.sweepSucceeded;
+             return status;
+          }
+
+          if (applySimpleTests(s))
+          {
+             resume.sweepSucceeded = true;
+          }
+       }
+    }
+
+    success = success or resume.sweepSucceeded;
+    return updateComplete;
  }
 
  /*
@@ -284,7 +916,11 @@ namespace minesweeper
   * not share with (n1 or n2 or n3) are definitely mined or not mined.
   * Update the probability map if anything is learned.
   */
- bool mineFieldProbMap::applyComplexTests(const square &s, unknownNboursSharedRec &unkNbsShared)
+ template<class Field>
+ bool basicMineFieldProbMap<Field>::applyComplexTests
+ (
+    const square &s, unknownNboursSharedRec &unkNbsShared
+ )
  {
     assert(Mptr->squareExplored(s));
 
@@ -316,7 +952,11 @@ namespace minesweeper
  /*
   *
   */
- bool mineFieldProbMap::findAndApplyAllComplexTests(const square &s, const int &n_otherSquares)
+ template<class Field>
+ bool basicMineFieldProbMap<Field>::findAndApplyAllComplexTests
+ (
+    const square &s, const int &n_otherSquares
+ )
  {
     assert(Mptr->squareExplored(s));
 
@@ -345,8 +985,11 @@ namespace minesweeper
                 {
                    if (applyComplexTests(s, unkNbsShared3))
                    {
-                      cout << "  Success at " << s << " using "
-                           << s1 << ", " << s2 << ", " << s3 << "." << endl;
+                      if (verbose)
+                      {
+                         cout << "  Success at " << s << " using "
+                              << s1 << ", " << s2 << ", " << s3 << "." << endl;
+                      }
                       return true;
                    }
 
@@ -357,7 +1000,10 @@ namespace minesweeper
              {
                 if (applyComplexTests(s, unkNbsShared2))
                 {
-                   cout << "  Success at " << s << " using " << s1 << ", " << s2 << "." << endl;
+                   if (verbose)
+                   {
+                      cout << "  Success at " << s << " using " << s1 << ", " << s2 << "." << endl;
+                   }
                    return true;
                 }
              }
@@ -369,7 +1015,7 @@ namespace minesweeper
        {
           if (applyComplexTests(s, unkNbsShared1))
           {
-             cout << "  Success at " << s << " using " << s1 << "." << endl;
+             if (verbose) {cout << "  Success at " << s << " using " << s1 << "." << endl;}
              return true;
           }
        }
@@ -381,33 +1027,43 @@ namespace minesweeper
  }
 
  /*
-  *
+  * Apply the tests involving n_otherSquares other squares to each square of the frontier from
+  * resume.pos onwards, stopping at the first success (and setting success).  Returns as
+  * applySimpleTestsToAllSquares() does.
   */
- bool mineFieldProbMap::applyComplexTestsUntilSuccess(const int &n_otherSquares)
+ template<class Field>
+ updateStatus basicMineFieldProbMap<Field>::applyComplexTestsUntilSuccess
+ (
+    const int &n_otherSquares, const updateLimits &limits, bool &success
+ )
  {
     assert(1 <= n_otherSquares && n_otherSquares <= 3);
 
-    unknownNboursSharedRec unkNbsShared;
-    square s;
+    const std::vector<square> &frontier = Mptr->getFrontier();
 
-    // For each square in the mineField...
-    for (s.row = 0; s.row < Mptr->getHeight(); ++s.row)
+    // For each remaining square of the frontier...
+    for (int &i = sweepPos(); i < int(frontier.size()); ++i)
     {
-       for (s.col = 0; s.col < Mptr->getWidth(); ++s.col)
+       const square &s = frontier[i];
+
+       if (n_unknownNbours(s))
        {
-          if
-          (
-             Mptr->squareExplored(s) and
-             n_unknownNbours(s)      and
-             findAndApplyAllComplexTests(s, n_otherSquares)
-          )
+          const updateStatus status = limits.stopReason();
+
+          if (status != updateComplete)
           {
-             return true;
+             return status;
+          }
+
+          if (findAndApplyAllComplexTests(s, n_otherSquares))
+          {
+             success = true;
+             return updateComplete;
           }
        }
     }
 
-    return false;
+    return updateComplete;
  }
 
  /*
@@ -416,7 +1072,8 @@ namespace minesweeper
   * where no neighbours are shared (ie. we are looking at s alone).
   * This function exists for efficiency reasons.
   */
- void mineFieldProbMap::setProbsOfUnknownNbours(const square &s, const double &p)
+ template<class Field>
+ void basicMineFieldProbMap<Field>::setProbsOfUnknownNbours(const square &s, const double &p)
  {
     assert(Mptr->squareExplored(s));
 
@@ -448,7 +1105,8 @@ namespace minesweeper
   * probabilities are unknown and which are not neighbours of n1 or n2 or n3.
   * L here is a list of unknown neighbours s shares with other squares.
   */
- void mineFieldProbMap::setProbsOfUnknownNboursNotShared
+ template<class Field>
+ void basicMineFieldProbMap<Field>::setProbsOfUnknownNboursNotShared
  (
     const square &s, const std::bitset<8> &L, const double &p
  )
@@ -481,7 +1139,8 @@ namespace minesweeper
  /*
   *
   */
- bool mineFieldProbMap::findAnotherSquare
+ template<class Field>
+ bool basicMineFieldProbMap<Field>::findAnotherSquare
  (
     const square &s, unknownNboursSharedRec &unkNbsShared, square &startPos, square &n
  ) const
@@ -550,7 +1209,8 @@ namespace minesweeper
   * Test whether square n has unknown neighbours not in list
   * containing a definite number of mines.
   */
- bool mineFieldProbMap::squareMeetsCriteria
+ template<class Field>
+ bool basicMineFieldProbMap<Field>::squareMeetsCriteria
  (
     const square &s, const square &n,
     const unknownNboursSharedRec &unkNbsShared,
@@ -603,7 +1263,8 @@ namespace minesweeper
  /*
   *
   */
- void mineFieldProbMap::updateUnkNbsShared
+ template<class Field>
+ void basicMineFieldProbMap<Field>::updateUnkNbsShared
  (
     unknownNboursSharedRec &unkNbsShared,
     const unknownNboursSharedRec &unkNbsSharedWn,
@@ -663,24 +1324,90 @@ namespace minesweeper
  }
 
  /*
-  *
+  * Return a new entry of the component cache with key hash, taking the node (and so the
+  * storage of the counts) of a spare entry if there is one not used by this call.
+  */
+ template<class Field>
+ typename basicMineFieldProbMap<Field>::componentCacheEntry &
+ basicMineFieldProbMap<Field>::newCacheEntry(const uint64_t &hash)
+ {
+    while (not spareEntries.empty())
+    {
+       const typename componentCacheMap::iterator i = componentCache.find(spareEntries.back());
+
+       spareEntries.pop_back();
+
+       if (i != componentCache.end() and i->second.generation != cacheGeneration)
+       {
+          typename componentCacheMap::node_type node = componentCache.extract(i);
+
+          node.key() = hash;
+
+          return componentCache.insert(std::move(node)).position->second;
+       }
+    }
+
+    return componentCache[hash];
+ }
+
+ /*
+  * Mark explored squares as clear.  Return true if any were not already.
   */
- void mineFieldProbMap::setProbOfExploredSquaresToZero(void)
+ template<class Field>
+ bool basicMineFieldProbMap<Field>::setProbOfExploredSquaresToZero(void)
  {
-    // Set prob to: -1.0 for all unexplored squares,
-    //               0.0 for all   explored squares.
-    for (int r = 0; r < Mptr->getHeight(); ++r)
+    bool probMapChanged = false;
+
+    // Set prob to 0.0 for all explored squares.  Where the minefield keeps a reveal log only
+    // the squares explored since the last call need be visited (all of them if the log has
+    // been truncated or restarted since).
+    if constexpr (requires (const Field &M) {M.getRevealLog(); M.getRevealLogVersion();})
+    {
+       const std::vector<square> &log = Mptr->getRevealLog();
+
+       if (revealLogVersion != Mptr->getRevealLogVersion())
+       {
+          revealLogVersion = Mptr->getRevealLogVersion();
+          revealCursor     = 0;
+       }
+
+       for (; revealCursor < int(log.size()); ++revealCursor)
+       {
+          probMapChanged = probMapChanged or not squareClear(log[revealCursor]);
+          setProbMined(log[revealCursor], 0.0);
+       }
+    }
+    else
     {
-       for (int c = 0; c < Mptr->getWidth(); ++c)
+       for (int r = 0; r < Mptr->getHeight(); ++r)
        {
-          if (Mptr->squareExplored(r, c))
+          for (int c = 0; c < Mptr->getWidth(); ++c)
           {
-             setProbMined(r, c,  0.0);
+             if (Mptr->squareExplored(r, c) and not squareClear(square(r, c)))
+             {
+                setProbMined(r, c,  0.0);
+                probMapChanged = true;
+             }
           }
        }
     }
+
+    return probMapChanged;
  }
 
 } // End namespace minesweeper.
 
+// Explicit instantiations. ////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ template class basicMineFieldProbMap<mineField>;
+ template class basicMineFieldProbMap< mineFieldT< 8,  8> >;
+ template class basicMineFieldProbMap< mineFieldT<16, 16> >;
+ template class basicMineFieldProbMap< mineFieldT<16, 30> >;
+ template class basicMineFieldProbMap<boardView>;
+
+} // End namespace minesweeper.
+
 /*******************************************END*OF*FILE********************************************/
@@ -18,9 +18,17 @@
 // Includes. ///////////////////////////////////////////////////////////////////////////////////////
 
 #include "minefield.h"
+#include "boardview.h"
+#include "enumerate.h"
 
+#include <algorithm>
+#include <atomic>
 #include <bitset>
+#include <chrono>
 #include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <cassert>
 
@@ -107,47 +115,197 @@ namespace minesweeper
  };
 
  /*
-  *
+  * Reasons for which update() may return.
   */
- class mineFieldProbMap
+ enum updateStatus
+ {
+    updateComplete,        // No test can deduce anything more.
+    updateDeadlineReached, // Stopped at the deadline.  Call update() again to continue.
+    updateCancelled        // Stopped because the cancellation flag was set.  Ditto.
+ };
+
+ /*
+  * Map of the probability that each square of a minefield is mined, deduced only from
+  * the explored territory of the minefield.
+  * Use typedef "mineFieldProbMap" for mineField, or "mineFieldProbMapT<H, W>" for mineFieldT<H, W>.
+  */
+ template<class Field>
+ class basicMineFieldProbMap
  {
   public:
 
     /* Constructor. */
-    mineFieldProbMap(const mineField *);
+    basicMineFieldProbMap(const Field *);
 
-    /* Reset all probability map values to unknown. */
+    /*
+     * Reset all probability map values to unknown.  Takes constant time: rows stamped with
+     * an earlier epoch read as unknown and are cleared when next written.
+     */
     void reset(void)
     {
-       for (int r = 0; r < Mptr->getHeight(); ++r)
+       if (++epoch == 0)
        {
-          for (int c = 0; c < Mptr->getWidth(); ++c)
-          {
-             probMap[r][c] = -1.0;
-          }
+          std::fill(rowEpoch.begin(), rowEpoch.end(), 0);
+          epoch = 1;
        }
+
+       revealCursor = 0;
+       resume.restart();
+       maxTestOrder = -1;
+
+       n_known           = 0;
+       n_knownMined      = 0;
+       unconstrainedProb = -1.0;
+
+       journal.clear();
+       snapshots.clear();
     }
 
     /* Update the probability map to take into account    *
      * knowledge from all squares that have been explored */
     bool update(void);
 
+    /*
+     * As update(), but stop early if the deadline passes or *cancelFlag (if given) becomes
+     * true, keeping everything deduced so far.  The next call to either version of update()
+     * continues from where this one stopped, unless the probability map has been changed
+     * by other means in between (reset(), popSnapshot(), assumeSquare*()) or squares have
+     * been explored, in which case it starts again from the beginning.  If probMapChanged is
+     * given, *probMapChanged is set to the value update() would return.
+     */
+    updateStatus update
+    (
+       const std::chrono::steady_clock::time_point &deadline,
+       const std::atomic<bool> *cancelFlag = 0, bool *probMapChanged = 0
+    );
+    updateStatus update(const std::atomic<bool> *cancelFlag, bool *probMapChanged = 0)
+    {return update(std::chrono::steady_clock::time_point::max(), cancelFlag, probMapChanged);}
+
+    /*
+     * Set the probability of each unknown square being mined, given that the minefield holds
+     * n_mines mines, by counting every assignment of mines consistent with the explored
+     * squares.  Frontier components are enumerated exactly (see "enumerate.h") and weighted
+     * by the ways of placing the remaining mines among the other unknown squares (see
+     * "modelcount.h").  Squares of components too large to enumerate are counted, and given
+     * probabilities, as if unconstrained.  Call after update().  Return true if any square
+     * was found definitely mined or clear, false otherwise or if the map is inconsistent.
+     */
+    bool updateProbabilities(const int &n_mines);
+
+    /*
+     * As updateProbabilities(), but give up if the deadline passes or *cancelFlag (if given)
+     * becomes true, leaving the probabilities as update() set them.  Enumeration is checked
+     * against the deadline as it runs, so this returns soon after the deadline even on large
+     * components.  If learned is given, *learned is set to the value updateProbabilities()
+     * would return (false if given up).
+     */
+    updateStatus updateProbabilities
+    (
+       const int &n_mines, const std::chrono::steady_clock::time_point &deadline,
+       const std::atomic<bool> *cancelFlag = 0, bool *learned = 0
+    );
+
+    /*
+     * Copy the state of P, a solver for a copy of this solver's minefield that is in the same
+     * state as it.  The minefield and verbosity of this solver are kept.
+     */
+    void copyState(const basicMineFieldProbMap &P)
+    {
+       const Field *M = Mptr;
+       const bool   v = verbose;
+
+       *this   = P;
+       Mptr    = M;
+       verbose = v;
+    }
+
     /* Print probability map to screen as text. */
     void printProbMap() const;
 
+    /* Add the bytes used by each structure of the solver to report, and return their sum. */
+    std::size_t memoryUsage(memoryReport &report) const;
+    std::size_t memoryUsage(void) const {memoryReport r; return memoryUsage(r);}
+
+    /*
+     * Return memoryUsage() of a solver for a minefield of the given size, not counting the
+     * component cache (which grows with the frontier as updateProbabilities() is used).
+     */
+    static std::size_t estimateMemoryUsage(const int &h, const int &w);
+
+    /*
+     * Return an estimate of the most the scratch arena (see "arena.h") of a thread running
+     * updateProbabilities() for a minefield of the given size holds between calls.  The arena
+     * is shared by all solvers on the thread, so is counted once per thread.
+     */
+    static std::size_t estimateScratchUsage(const int &h, const int &w);
+
+    /*
+     * Return the highest number of other squares (1 - 3) involved in a successful test since
+     * reset(), 0 if only the simple tests have succeeded or -1 if no test has.
+     */
+    int getMaxTestOrder(void) const {return maxTestOrder;}
+
+    /* Turn progress messages printed by update() on or off (on by default). */
+    void setVerbose(const bool &v) {verbose = v;}
+    bool getVerbose(void) const {return verbose;}
+
+    /** Speculation functions. **/
+
+    /*
+     * Changes made to a solver since a snapshot, as recorded by popSnapshot(), so that the
+     * result of a speculation can be kept without a copy of the solver.
+     */
+    class snapshotDelta
+    {
+     public:
+       snapshotDelta(void) : maxTestOrder(-1), unconstrainedProb(-1.0) {}
+
+       std::vector< std::pair<square, double> > probs; // Probabilities set, in order.
+       int                                      maxTestOrder;
+       double                                   unconstrainedProb;
+    };
+
+    /*
+     * Snapshots are recorded as an undo journal of probability map changes so that hypotheses
+     * may be explored (using assumeSquareClear/Mined() and update()) then cheaply discarded.
+     * Snapshots nest.  reset() discards all snapshots.  If delta is given, popSnapshot()
+     * records in it the changes it undoes, which applySnapshotDelta() makes again to a solver
+     * (for a minefield) in the state this one was in when the snapshot was taken.
+     */
+    void pushSnapshot(void)
+    {
+       snapshots.push_back
+       (
+          snapshotMark(journal.size(), revealCursor, n_known, n_knownMined, unconstrainedProb)
+       );
+    }
+    void popSnapshot(snapshotDelta *delta = 0);
+    void applySnapshotDelta(const snapshotDelta &delta);
+    int  getSnapshotDepth(void) const {return snapshots.size();}
+
+    /* Return the number of squares whose probability has changed since pushSnapshot(). */
+    int getSnapshotChanges(void) const
+    {assert(not snapshots.empty()); return journal.size() - snapshots.back().journalSize;}
+
+    /* Assume for the purposes of speculation that square s is clear or mined. */
+    void assumeSquareClear(const square &s)
+    {assert(not squareKnown(s)); setProbMined(s, 0.0); resume.restart();}
+    void assumeSquareMined(const square &s)
+    {assert(not squareKnown(s)); setProbMined(s, 1.0); resume.restart();}
+
     /* Return the probability of a square being mined.                  *
      * Only valid if probMap has been update()ed since last exploration */
-    double getProbMined(const square &s) const {return probMap[s.row][s.col];}
+    double getProbMined(const square &s) const {return probValue(s);}
 
     /** Boolean test functions. **/
 
     /* Test whether square is known to be definitely clear. */
     bool squareClear(const square &s) const
-    {assert(Mptr->squareInsideMap(s)); return probMap[s.row][s.col] == 0.0;}
+    {assert(Mptr->squareInsideMap(s)); return probValue(s) == 0.0;}
 
     /* Test whether square is known to be definitely mined. */
     bool squareMined(const square &s) const
-    {assert(Mptr->squareInsideMap(s)); return probMap[s.row][s.col] == 1.0;}
+    {assert(Mptr->squareInsideMap(s)); return probValue(s) == 1.0;}
     bool squareMined(const int &r, const int &c) const {return squareMined(square(r, c));}
 
     /* Test whether squares state is known definitely (mined or clear). */
@@ -156,7 +314,7 @@ namespace minesweeper
 
     /* Test whether squares probability is known. */
     bool probKnown(const square &s) const
-    {assert(Mptr->squareInsideMap(s)); return probMap[s.row][s.col] != -1.0;}
+    {assert(Mptr->squareInsideMap(s)); return probValue(s) != -1.0;}
 
   private:
     // Private function declarations / inline definitions. //////////////////////////////////////
@@ -189,12 +347,23 @@ namespace minesweeper
 
     /** Misc. functions. **/
 
+    class updateLimits;
+
+    updateStatus runUpdate(const updateLimits &limits, bool &probMapChanged);
+    updateStatus runUpdateProbabilities
+    (
+       const int &n_mines, const updateLimits &limits, bool &learned
+    );
+
     bool applySimpleTests(const square &s);
-    bool applySimpleTestsToAllSquares(void);
+    updateStatus applySimpleTestsToAllSquares(const updateLimits &limits, bool &success);
 
     bool applyComplexTests(const square &s, unknownNboursSharedRec &unkNbsShared);
     bool findAndApplyAllComplexTests(const square &s, const int &n_otherSquares);
-    bool applyComplexTestsUntilSuccess(const int &n_otherSquares);
+    updateStatus applyComplexTestsUntilSuccess
+    (
+       const int &n_otherSquares, const updateLimits &limits, bool &success
+    );
 
     void setProbsOfUnknownNbours(const square &s, const double &p);
     void setProbsOfUnknownNboursNotShared
@@ -222,23 +391,219 @@ namespace minesweeper
        const square &s, const square &n
     ) const;
 
-    void setProbOfExploredSquaresToZero(void);
+    bool setProbOfExploredSquaresToZero(void);
+
+    /* Return resume.pos, first starting the sweep again if the frontier has changed. */
+    int &sweepPos(void)
+    {
+       if (resume.frontierVersion != Mptr->getFrontierVersion())
+       {
+          resume.frontierVersion = Mptr->getFrontierVersion();
+          resume.pos             = 0;
+       }
+
+       return resume.pos;
+    }
+
+    /*
+     * Return probMap[s.row][s.col], reading squares not written since the last reset() (rows
+     * stamped with an earlier epoch) as unconstrainedProb.
+     */
+    double probValue(const square &s) const
+    {
+       const double p = (rowEpoch[s.row] == epoch)? probMap[s.row][s.col]: -1.0;
+       return (p == -1.0)? unconstrainedProb: p;
+    }
+
+    /* Test whether a probability has been set for s since the last reset(). */
+    bool probSet(const square &s) const
+    {return rowEpoch[s.row] == epoch and probMap[s.row][s.col] != -1.0;}
 
     void setProbMined(const square &s, const double &p)
-    {assert(0.0 <= p and p <= 1.0); assert(Mptr->squareInsideMap(s)); probMap[s.row][s.col] = p;}
+    {
+       assert(0.0 <= p and p <= 1.0);
+       assert(Mptr->squareInsideMap(s));
+
+       if (rowEpoch[s.row] != epoch)
+       {
+          std::fill(probMap[s.row].begin(), probMap[s.row].end(), -1.0); // Unknown.
+          rowEpoch[s.row] = epoch;
+       }
+
+       double &prob = probMap[s.row][s.col];
+
+       if (prob != p)
+       {
+          if (not snapshots.empty()) {journal.push_back(probMapChange(s, prob));}
+
+          const bool wasKnown = (prob == 0.0 or prob == 1.0), isKnown = (p == 0.0 or p == 1.0);
+
+          n_known      += int(isKnown)  - int(wasKnown);
+          n_knownMined += int(p == 1.0) - int(prob == 1.0);
+
+          prob = p;
+       }
+    }
     void setProbMined(const int &r, const int &c, const double &p) {setProbMined(square(r, c), p);}
 
+    // Private class definitions. ///////////////////////////////////////////////////////////////
+
+    class probMapChange
+    {
+     public:
+       probMapChange(const square &_s, const double &_oldProb)
+       : s(_s), oldProb(_oldProb)
+       {}
+
+       square s;
+       double oldProb;
+    };
+
+    /*
+     * Position at which an interrupted update() is to continue.  Phase 0 is the simple tests,
+     * phase n (1 <= n <= 3) the tests involving n other squares.  Each phase sweeps the
+     * minefield's frontier, so a sweep starts again if the frontier has changed since pos was
+     * recorded.
+     */
+    class updateCursor
+    {
+     public:
+       updateCursor(void) : frontierVersion(0) {restart();}
+
+       void restart(void) {phase = 0; pos = 0; sweepSucceeded = false;}
+
+       bool atStart(void) const {return phase == 0 and pos == 0 and not sweepSucceeded;}
+
+       int      phase;
+       int      pos;             // Position in the frontier of the next square to test.
+       unsigned frontierVersion; // Frontier version to which pos refers.
+       bool     sweepSucceeded;  // A simple test has succeeded during the current sweep.
+    };
+
+    /*
+     * Counts of a frontier component, kept between calls to updateProbabilities() so that
+     * components unchanged since the last call are not enumerated again.  A component is
+     * identified by its number of cells, the most mines it may hold and its constraints
+     * (sorted, without duplicates), as its cells are numbered in the order found by a scan of
+     * its own explored squares and so independently of the rest of the board.
+     */
+    class componentCacheEntry
+    {
+     public:
+       componentCacheEntry(void) : n_cells(0), maxMines(0), complete(false), generation(0) {}
+
+       /* Hash of the key of a component with the constraints from begin to end. */
+       static uint64_t hash
+       (
+          const int &n_cells, const int &maxMines,
+          const componentConstraint *begin, const componentConstraint *end
+       );
+
+       bool sameComponent
+       (
+          const int &_n_cells, const int &_maxMines,
+          const componentConstraint *begin, const componentConstraint *end
+       ) const
+       {
+          return
+          (
+             n_cells == _n_cells and maxMines == _maxMines and
+             std::equal(constraints.begin(), constraints.end(), begin, end)
+          );
+       }
+
+       void setKey
+       (
+          const int &_n_cells, const int &_maxMines,
+          const componentConstraint *begin, const componentConstraint *end
+       )
+       {n_cells = _n_cells; maxMines = _maxMines; constraints.assign(begin, end);}
+
+       int                              n_cells, maxMines;
+       std::vector<componentConstraint> constraints;
+       bool                             complete;   // Enumeration finished within its budget.
+       unsigned                         generation; // Call of updateProbabilities() that
+                                                    // last used the entry.
+       componentCounts                  counts;
+    };
+
+    typedef std::unordered_map<uint64_t, componentCacheEntry> componentCacheMap;
+
+    componentCacheEntry &newCacheEntry(const uint64_t &hash);
+
+    class snapshotMark
+    {
+     public:
+       snapshotMark
+       (
+          const int &_journalSize, const int &_revealCursor, const long &_n_known,
+          const long &_n_knownMined, const double &_unconstrainedProb
+       )
+       : journalSize(_journalSize), revealCursor(_revealCursor), n_known(_n_known),
+         n_knownMined(_n_knownMined), unconstrainedProb(_unconstrainedProb)
+       {}
+
+       int    journalSize;
+       int    revealCursor;
+       long   n_known, n_knownMined;
+       double unconstrainedProb;
+    };
+
     // Private constants & variables. ///////////////////////////////////////////////////////////
 
-    const mineField *Mptr;
+    const Field *Mptr;
+
+    bool verbose;
+
+    typename Field::dimsType::template grid<double> probMap; // Probability of square being mined.
+                                                            //  map[r][c] =
+                                                            //   1.0 if definitely mined
+                                                            //   range(0.0, 1.0) if uncertain
+                                                            //   0.0 if definitely clear
+                                                            //  -1.0 if not set since reset()
+                                                            // (Only valid for rows r where
+                                                            //  rowEpoch[r] == epoch.)
+
+    typename Field::dimsType::template rowArray<unsigned> rowEpoch; // Epoch in which each row
+                                                                    // of probMap was last written.
+    unsigned epoch;                                                 // Incremented by reset().
 
-    std::vector< std::vector<double> > probMap; // Probability of square being mined.
-                                                //  map[r][c] = 1.0 if definitely mined
-                                                //              range(0.0, 1.0) if prob. uncertain
-                                                //              0.0 if definitely clear
-                                                //             -1.0 if probability unknown
+    double unconstrainedProb; // Probability of the squares not set (those not next to explored
+                              // squares when updateProbabilities() last ran, -1.0 before).
+
+    long n_known, n_knownMined; // Squares set definitely clear or mined, and definitely mined.
+
+    int      revealCursor;     // Number of entries of the minefield's reveal log (if it has one)
+    unsigned revealLogVersion; // already applied by setProbOfExploredSquaresToZero(), and the
+                               // version of the log at the time.
+
+    updateCursor resume; // Where the next update() continues.
+
+    int maxTestOrder; // See getMaxTestOrder().
+
+    componentCacheMap     componentCache;  // Components seen by the last two calls of
+    unsigned              cacheGeneration; // updateProbabilities(), numbered by the calls.
+    std::vector<uint64_t> spareEntries;    // Keys of those not seen by the last call, whose
+                                           // storage is reused for new components.
+
+    std::vector<probMapChange> journal;   // Undo journal of probMap changes (only kept while
+                                          // at least one snapshot is active).
+    std::vector<snapshotMark>  snapshots; // Stack of active snapshots.
  };
 
+ // Typedefs and explicit instantiations. ////////////////////////////////////////////////////////
+
+ typedef basicMineFieldProbMap<mineField> mineFieldProbMap;
+
+ template<int H, int W> using mineFieldProbMapT = basicMineFieldProbMap< mineFieldT<H, W> >;
+
+ // Defined in "mineprob.cpp".
+ extern template class basicMineFieldProbMap<mineField>;
+ extern template class basicMineFieldProbMap< mineFieldT< 8,  8> >;
+ extern template class basicMineFieldProbMap< mineFieldT<16, 16> >;
+ extern template class basicMineFieldProbMap< mineFieldT<16, 30> >;
+ extern template class basicMineFieldProbMap<boardView>;
+
 } // End namespace minesweeper.
 
 #endif
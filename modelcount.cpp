@@ -0,0 +1,270 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "modelcount.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Weighting of frontier components by the ways of placing the remaining mines.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "modelcount.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <cmath>
+
+// File-scope definitions. /////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ const double logZero = -std::numeric_limits<double>::infinity();
+
+ /*
+  * Accumulates a sum of terms given as logarithms.  Terms are collected first so that each is
+  * exponentiated relative to the largest.
+  */
+ class logSum
+ {
+  public:
+    logSum(void) : n_terms(0), maxTerm(logZero) {}
+
+    void add(const double &t)
+    {
+       if (t == logZero) {return;}
+       terms[n_terms++] = t;
+       maxTerm = std::max(maxTerm, t);
+
+       if (n_terms == maxTerms)
+       {
+          const double partial = get(); // Fold the terms so far into one.
+          n_terms  = 0;
+          terms[n_terms++] = partial;
+          maxTerm  = partial;
+       }
+    }
+
+    double get(void) const
+    {
+       if (maxTerm == logZero) {return logZero;}
+
+       double sum = 0.0;
+
+       for (int i = 0; i < n_terms; ++i)
+       {
+          sum += std::exp(terms[i] - maxTerm);
+       }
+
+       return maxTerm + std::log(sum);
+    }
+
+  private:
+    enum {maxTerms = 72};
+
+    double terms[maxTerms];
+    int    n_terms;
+    double maxTerm;
+ };
+
+ /*
+  * The logarithm of the number of solutions of a component with k mines, for k up to the
+  * largest number with any.
+  */
+ scratchVector<double> logSolutions(const componentCounts &c)
+ {
+    int kMax = int(c.n_solutions.size()) - 1;
+
+    while (kMax > 0 and c.n_solutions[kMax] == 0.0)
+    {
+       --kMax;
+    }
+
+    scratchVector<double> logN(kMax + 1);
+
+    for (int k = 0; k <= kMax; ++k)
+    {
+       logN[k] = (c.n_solutions[k] > 0.0)? std::log(c.n_solutions[k]): logZero;
+    }
+
+    return logN;
+ }
+}
+
+// Public function definitions. ////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ double logBinomial(const long &n, const long &k)
+ {
+    if (k < 0 or k > n)
+    {
+       return logZero;
+    }
+
+    return std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0);
+ }
+
+ /*
+  * Components are combined as a chain.  With forward[x] the log weight of the first j
+  * components holding x mines, and backward[j + 1][x] that of the remaining components and
+  * the interior given x mines in the first j, the weight of component j holding k mines is
+  * N_j(k) * sum_x forward[x] * backward[j + 1][x + k].
+  */
+ bool weightComponents
+ (
+    const scratchVector<const componentCounts *> &components,
+    const long &n_interior, const long &n_mines,
+    scratchVector< scratchVector<double> > &probMined, double &interiorProb
+ )
+ {
+    const int n_components = int(components.size());
+
+    scratchVector< scratchVector<double> > logN(n_components);
+    scratchVector<int>                     prefixMax(n_components + 1, 0); // Mines in first j.
+
+    for (int j = 0; j < n_components; ++j)
+    {
+       logN[j]          = logSolutions(*components[j]);
+       prefixMax[j + 1] = prefixMax[j] + int(logN[j].size()) - 1;
+    }
+
+    // Backward pass.
+    scratchVector< scratchVector<double> > backward(n_components + 1);
+
+    backward[n_components].resize(prefixMax[n_components] + 1);
+
+    for (int x = 0; x <= prefixMax[n_components]; ++x)
+    {
+       backward[n_components][x] = logBinomial(n_interior, n_mines - x);
+    }
+
+    for (int j = n_components - 1; j >= 0; --j)
+    {
+       backward[j].resize(prefixMax[j] + 1);
+
+       for (int x = 0; x <= prefixMax[j]; ++x)
+       {
+          logSum sum;
+
+          for (int k = 0; k < int(logN[j].size()); ++k)
+          {
+             sum.add(logN[j][k] + backward[j + 1][x + k]);
+          }
+
+          backward[j][x] = sum.get();
+       }
+    }
+
+    const double logTotal = backward[0][0];
+
+    if (logTotal == logZero)
+    {
+       return false;
+    }
+
+    // Forward pass, finding the probabilities of each component in turn.
+    scratchVector<double> forward(1, 0.0), nextForward;
+
+    forward.reserve(prefixMax[n_components] + 1);
+    nextForward.reserve(prefixMax[n_components] + 1);
+
+    probMined.resize(n_components);
+
+    for (int j = 0; j < n_components; ++j)
+    {
+       const componentCounts &c     = *components[j];
+       const int              n_k   = int(logN[j].size());
+       scratchVector<double>  weight(n_k); // Log weight of the rest given k mines here.
+
+       for (int k = 0; k < n_k; ++k)
+       {
+          logSum sum;
+
+          for (int x = 0; x <= prefixMax[j]; ++x)
+          {
+             sum.add(forward[x] + backward[j + 1][x + k]);
+          }
+
+          weight[k] = sum.get();
+       }
+
+       probMined[j].assign(c.n_cells, 0.0);
+
+       for (int i = 0; i < c.n_cells; ++i)
+       {
+          double pMined = 0.0, pClear = 0.0;
+
+          for (int k = 0; k < n_k; ++k)
+          {
+             if (logN[j][k] != logZero and weight[k] != logZero)
+             {
+                const double w = std::exp(weight[k] - logTotal);
+
+                pMined += w * c.n_mined[k][i];
+                pClear += w * (c.n_solutions[k] - c.n_mined[k][i]);
+             }
+          }
+
+          // Keep certainties exact so that they read as deductions.
+          probMined[j][i] = (pClear == 0.0)? 1.0: std::min(pMined, 1.0);
+       }
+
+       nextForward.assign(prefixMax[j + 1] + 1, logZero);
+
+       for (int x = 0; x <= prefixMax[j + 1]; ++x)
+       {
+          logSum sum;
+
+          for (int k = std::max(0, x - prefixMax[j]); k < n_k and k <= x; ++k)
+          {
+             sum.add(forward[x - k] + logN[j][k]);
+          }
+
+          nextForward[x] = sum.get();
+       }
+
+       forward.swap(nextForward);
+    }
+
+    // The expected number of mines in the interior.
+    interiorProb = 0.0;
+
+    if (n_interior > 0)
+    {
+       double interiorClear = 0.0;
+
+       for (int x = 0; x <= prefixMax[n_components]; ++x)
+       {
+          const double w = forward[x] + backward[n_components][x];
+
+          if (w != logZero)
+          {
+             const double p = std::exp(w - logTotal);
+
+             interiorProb  += p * double(n_mines - x) / n_interior;
+             interiorClear += p * double(n_interior - n_mines + x) / n_interior;
+          }
+       }
+
+       interiorProb = (interiorClear == 0.0)? 1.0: std::min(interiorProb, 1.0);
+    }
+
+    return true;
+ }
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,59 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "modelcount.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Weighting of frontier components by the ways of placing the remaining mines.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef MODELCOUNT_H
+#define MODELCOUNT_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "enumerate.h"
+#include "arena.h"
+
+// Function declarations. //////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Return the natural logarithm of the binomial coefficient C(n, k), or minus infinity if
+  * k < 0 or k > n.
+  */
+ double logBinomial(const long &n, const long &k);
+
+ /*
+  * Find the probability that each square is mined, given the counts of the independent
+  * frontier components and n_interior unconstrained squares, with n_mines mines in all.
+  *
+  * An assignment in which the components hold k_1, k_2, ... mines (K in total) is weighted by
+  * C(n_interior, n_mines - K).  The weights are held as logarithms, and the distributions of
+  * the components combined by convolution (forwards, then backwards with the interior), so
+  * that nothing overflows however large the board.
+  *
+  * Sets probMined[j][i] for cell i of component j, and interiorProb for each interior square
+  * (0 if there are none).  Return false if no assignment of the n_mines mines is consistent.
+  * Working data, and probMined, are taken from the calling thread's scratch arena (see
+  * "arena.h") and so last until the caller's scratchScope ends.
+  */
+ bool weightComponents
+ (
+    const scratchVector<const componentCounts *> &components,
+    const long &n_interior, const long &n_mines,
+    scratchVector< scratchVector<double> > &probMined, double &interiorProb
+ );
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
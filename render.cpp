@@ -0,0 +1,221 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "render.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Function definitions for class template "boardRenderer".
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "render.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include <cstdio>
+
+#include <unistd.h>
+
+// Public function definitions. ////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Constructor.
+  */
+ template<class Field>
+ boardRenderer<Field>::boardRenderer
+ (
+    const Field &_M, const basicMineFieldProbMap<Field> *_P,
+    const int &_viewRows, const int &_viewCols
+ )
+ : M(_M), P(_P),
+   viewRows(std::max(1, std::min(_viewRows, _M.getHeight()))),
+   viewCols(std::max(1, std::min(_viewCols, _M.getWidth()))),
+   origin(0, 0), shown(showMap), follow(true),
+   onScreen(viewRows * viewCols, 0), cleared(false), pending(false),
+   cursorLine(0), cursorCol(0),
+   minInterval(33) // About 30 frames per second.
+ {}
+
+ /*
+  *
+  */
+ template<class Field>
+ void boardRenderer<Field>::draw(const bool &force)
+ {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if (not force and cleared and now - lastDraw < minInterval)
+    {
+       pending = true;
+       return;
+    }
+
+    pending  = false;
+    lastDraw = now;
+
+    if (follow and not M.getRevealLog().empty())
+    {
+       const square &s = M.getRevealLog().back();
+
+       if
+       (
+          s.row < origin.row or s.row >= origin.row + viewRows or
+          s.col < origin.col or s.col >= origin.col + viewCols
+       )
+       {
+          setOrigin(s.row - viewRows / 2, s.col - viewCols / 2);
+       }
+    }
+
+    frame.clear();
+    cursorLine = 0; // Unknown (prompts may have moved it).
+
+    if (not cleared)
+    {
+       frame += "\x1b[H\x1b[2J";
+       cursorLine = cursorCol = 1;
+       std::fill(onScreen.begin(), onScreen.end(), 0);
+       lastStatus.clear();
+       cleared = true;
+    }
+
+    // Status line.
+    std::ostringstream statusLine;
+    statusLine << status << (status.empty()? "": "  ")
+               << "[rows "      << origin.row << "-" << origin.row + viewRows - 1
+               << " of "        << M.getHeight()
+               << ", cols "     << origin.col << "-" << origin.col + viewCols - 1
+               << " of "        << M.getWidth()
+               << ", frontier " << M.getFrontier().size() << "]";
+
+    if (statusLine.str() != lastStatus)
+    {
+       lastStatus = statusLine.str();
+       moveTo(1, 1);
+       frame += lastStatus;
+       frame += "\x1b[K"; // Clear rest of line.
+       cursorLine = 0;
+    }
+
+    // Squares whose glyph has changed.  Each square is two columns wide as in printMap().
+    for (int vr = 0; vr < viewRows; ++vr)
+    {
+       for (int vc = 0; vc < viewCols; ++vc)
+       {
+          const char g = glyph(square(origin.row + vr, origin.col + vc));
+          char      &o = onScreen[vr * viewCols + vc];
+
+          if (g != o)
+          {
+             moveTo(vr + 2, 2 * vc + 1);
+             frame += g;
+             frame += ' ';
+             cursorCol += 2;
+             o = g;
+          }
+       }
+    }
+
+    moveTo(viewRows + 2, 1);
+    frame += "\x1b[J"; // Clear rest of screen.
+
+    // Write the frame at once, after anything already buffered by std::cout.
+    std::cout.flush();
+
+    for (std::string::size_type done = 0; done < frame.size();)
+    {
+       const ssize_t n = write(STDOUT_FILENO, frame.data() + done, frame.size() - done);
+
+       if (n <= 0)
+       {
+          break;
+       }
+
+       done += n;
+    }
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ void boardRenderer<Field>::setOrigin(const int &top, const int &left)
+ {
+    origin.row = std::max(0, std::min(top,  M.getHeight() - viewRows));
+    origin.col = std::max(0, std::min(left, M.getWidth()  - viewCols));
+ }
+
+} // End namespace minesweeper.
+
+// Private function definitions. ///////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ template<class Field>
+ char boardRenderer<Field>::glyph(const square &s) const
+ {
+    if (shown == showProbMap and P != 0)
+    {
+       if (not P->probKnown(s)) {return '*';}
+
+       const double p = P->getProbMined(s);
+
+       if (p == 0.0) {return '.';}
+       if (p == 1.0) {return 'M';}
+
+       return char('0' + int(p * 10.0));
+    }
+
+    if (M.squareExplored(s)) {return char('0' + M.n_minedNbours(s));}
+    if (M.squareFlagged(s) ) {return 'F';}
+
+    return '-';
+ }
+
+ /*
+  * Append a cursor move to frame unless the cursor is already at (line, col).
+  */
+ template<class Field>
+ void boardRenderer<Field>::moveTo(const int &line, const int &col)
+ {
+    if (line != cursorLine or col != cursorCol)
+    {
+       char buffer[32];
+       snprintf(buffer, sizeof(buffer), "\x1b[%d;%dH", line, col);
+       frame += buffer;
+
+       cursorLine = line;
+       cursorCol  = col;
+    }
+ }
+
+} // End namespace minesweeper.
+
+// Explicit instantiations. ////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ template class boardRenderer<mineField>;
+ template class boardRenderer< mineFieldT< 8,  8> >;
+ template class boardRenderer< mineFieldT<16, 16> >;
+ template class boardRenderer< mineFieldT<16, 30> >;
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,123 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "render.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Class template "boardRenderer" definition.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef RENDER_H
+#define RENDER_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "minefield.h"
+#include "mineprob.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Class definition. ///////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Draws a window (the viewport) of a minefield or its probability map on an ANSI terminal.
+  * The frame occupies the top lines of the screen: a status line (also showing the size of
+  * the frontier), then one line per row of the viewport.  Each frame is built in a buffer
+  * and written at once, and only squares whose glyph has changed since the previous frame
+  * are written (using cursor moves).
+  * After drawing, the cursor is left at the start of the line below the frame with the rest
+  * of the screen cleared, ready for prompts.
+  *
+  * Glyphs are as printMap() ('0' to '8' explored, 'F' flagged, '-' unexplored), or for the
+  * probability map '.' clear, 'M' mined, '0' to '9' tenths of probability, '*' unknown.
+  */
+ template<class Field>
+ class boardRenderer
+ {
+  public:
+    enum mode {showMap, showProbMap};
+
+    /* Constructor.  P may be null if the probability map is not to be shown. */
+    boardRenderer
+    (
+       const Field &M, const basicMineFieldProbMap<Field> *P,
+       const int &viewRows, const int &viewCols
+    );
+
+    /*
+     * Draw the frame if at least the minimum interval has passed since the last, otherwise
+     * only note that a draw is pending (drawn by the next draw() or flush()).  If force is
+     * true draw regardless.
+     */
+    void draw(const bool &force = false);
+
+    /* Draw the frame if a draw is pending. */
+    void flush(void) {if (pending) {draw(true);}}
+
+    /* Redraw the whole frame next time (eg. after other output has scrolled the screen). */
+    void invalidate(void) {cleared = false;}
+
+    /* Viewport control.  The viewport is kept inside the map. */
+    void setOrigin(const int &top, const int &left);
+    void scroll(const int &dRows, const int &dCols)
+    {setOrigin(origin.row + dRows, origin.col + dCols);}
+
+    /* Scroll (if necessary) so that the most recently explored square is in view. */
+    void followFrontier(const bool &f) {follow = f;}
+
+    int getViewRows(void) const {return viewRows;}
+    int getViewCols(void) const {return viewCols;}
+
+    mode getMode(void) const {return shown;}
+    void setMode(const mode &m) {if (m != shown) {shown = m; invalidate();}}
+    void setStatus(const std::string &s) {status = s;}
+    void setMinInterval(const std::chrono::milliseconds &i) {minInterval = i;}
+
+  private:
+    char glyph(const square &s) const;
+    void moveTo(const int &line, const int &col);
+
+    const Field                        &M;
+    const basicMineFieldProbMap<Field> *P;
+
+    const int viewRows, viewCols; // Size of viewport (in squares).
+
+    square origin; // Square at top left of viewport.
+    mode   shown;
+    bool   follow;
+
+    std::string status;
+
+    std::vector<char> onScreen;   // Glyph of each square of the viewport as last drawn.
+    std::string       lastStatus; // Status line as last drawn.
+    bool              cleared;    // Screen has been cleared and onScreen is valid.
+    bool              pending;    // A draw was skipped by rate limiting.
+
+    std::string frame;            // Output buffer.
+    int         cursorLine;       // Cursor position while building frame (1 based).
+    int         cursorCol;
+
+    std::chrono::milliseconds             minInterval;
+    std::chrono::steady_clock::time_point lastDraw;
+ };
+
+ extern template class boardRenderer<mineField>;
+ extern template class boardRenderer< mineFieldT< 8,  8> >;
+ extern template class boardRenderer< mineFieldT<16, 16> >;
+ extern template class boardRenderer< mineFieldT<16, 30> >;
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,697 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "server.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Solver daemon listening on a Unix domain socket, and the matching client functions.
+*
+*          One I/O thread accepts connections, reads requests and writes replies, reading or
+*          writing whatever each client's socket allows without waiting for the rest, so that
+*          a slow client holds up no other.  Solve requests are queued and taken in batches by
+*          a pool of worker threads, each of which keeps solvers for the board sizes it has
+*          seen most recently so that they stay warm, and hands each reply back to the I/O
+*          thread to send.  A client may have one request outstanding at a time; its socket is
+*          not read from until the reply to that request has been sent.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "server.h"
+#include "libminesweeper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// File-scope constants, classes & functions. //////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ typedef std::chrono::steady_clock steadyClock;
+
+ const int maxBatchSize     =    16; // Maximum number of jobs a worker takes at once.
+ const int n_latencySamples = 65536; // Number of most recent latencies kept for percentiles.
+ const int maxSolvers       =     8; // Most solvers (board sizes) each worker keeps.
+ const int shutdownWaitMs   =  1000; // How long to wait for a client to take its reply when
+                                     //  stopping.
+
+ /*
+  * Read or write exactly n bytes.  Return false on error or end of file.
+  */
+ bool readFully(const int &fd, void *buf, size_t n)
+ {
+    char *p = static_cast<char *>(buf);
+
+    while (n > 0)
+    {
+       const ssize_t got = read(fd, p, n);
+       if (got <= 0) {return false;}
+       p += got;
+       n -= got;
+    }
+
+    return true;
+ }
+
+ bool writeFully(const int &fd, const void *buf, size_t n)
+ {
+    const char *p = static_cast<const char *>(buf);
+
+    while (n > 0)
+    {
+       const ssize_t put = send(fd, p, n, MSG_NOSIGNAL);
+       if (put <= 0) {return false;}
+       p += put;
+       n -= put;
+    }
+
+    return true;
+ }
+
+ /*
+  * A solve request waiting for (or being processed by) a worker.
+  */
+ class solveJob
+ {
+  public:
+    int                        fd;
+    serverRequestHeader        header;
+    std::vector<unsigned char> cells;
+    steadyClock::time_point    received;
+ };
+
+ /*
+  * A client connection, and the request being read from it.
+  */
+ class clientConnection
+ {
+  public:
+    clientConnection(void) : busy(false), n_read(0), n_written(0) {}
+
+    bool                       busy;      // A request is with a worker.
+    serverRequestHeader        header;
+    size_t                     n_read;    // Bytes of the request (header then cells) read.
+    std::vector<unsigned char> cells;
+    std::vector<unsigned char> output;    // Reply being sent.
+    size_t                     n_written; // Bytes of the reply sent.
+ };
+
+ /*
+  * State shared between the I/O thread and the workers.
+  */
+ class serverState
+ {
+  public:
+    serverState(void) : stopping(false), n_solved(0), n_batches(0), n_latencies(0)
+    {latencies.resize(n_latencySamples);}
+
+    std::mutex              mutex;
+    std::condition_variable jobsAvailable;
+    std::deque<solveJob>    jobs;
+    bool                    stopping;
+
+    // (fd, reply) from workers, for the I/O thread to send.
+    std::vector< std::pair< int, std::vector<unsigned char> > > replies;
+    int wakePipe[2]; // Written by workers to wake I/O thread.
+
+    uint64_t            n_solved, n_batches, n_latencies;
+    std::vector<double> latencies;                   // Ring buffer (microseconds).
+ };
+
+ /*
+  * Fill in stats from the shared state.  Only the copying is done under the lock, so that
+  * workers are not held up by the sort.
+  */
+ void getStats(serverState &S, serverStatsReply &stats)
+ {
+    std::vector<double> sorted;
+    {
+       std::lock_guard<std::mutex> lock(S.mutex);
+
+       sorted.assign
+       (
+          S.latencies.begin(),
+          S.latencies.begin() + std::min<uint64_t>(S.n_latencies, S.latencies.size())
+       );
+
+       stats.n_solved  = S.n_solved;
+       stats.n_batches = S.n_batches;
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+
+    if (sorted.empty())
+    {
+       stats.latencyP50 = stats.latencyP90 = stats.latencyP99 = stats.latencyMax = 0.0;
+       return;
+    }
+
+    // Nearest rank percentiles.
+    const int n = sorted.size();
+    stats.latencyP50 = sorted[std::min(n - 1, n * 50 / 100)];
+    stats.latencyP90 = sorted[std::min(n - 1, n * 90 / 100)];
+    stats.latencyP99 = sorted[std::min(n - 1, n * 99 / 100)];
+    stats.latencyMax = sorted[n - 1];
+ }
+
+ /*
+  * Worker thread.  Solvers are created on first use for each board size and kept until
+  * the server shuts down, except that beyond maxSolvers the least recently used is
+  * destroyed.
+  */
+ void workerLoop(serverState &S)
+ {
+    typedef std::map< std::pair<int, int>, std::pair<ms_solver *, uint64_t> > solverMap;
+
+    solverMap                  solvers; // Board size -> (solver, job number last used).
+    uint64_t                   n_jobs = 0;
+    std::vector<solveJob>      batch;
+    std::vector<unsigned char> deductions;
+    std::vector<double>        probs;
+
+    for (;;)
+    {
+       batch.clear();
+       {
+          std::unique_lock<std::mutex> lock(S.mutex);
+          S.jobsAvailable.wait(lock, [&S] {return S.stopping or not S.jobs.empty();});
+
+          if (S.jobs.empty())
+          {
+             break; // Stopping and nothing left to do.
+          }
+
+          while (not S.jobs.empty() and int(batch.size()) < maxBatchSize)
+          {
+             batch.push_back(std::move(S.jobs.front()));
+             S.jobs.pop_front();
+          }
+
+          ++S.n_batches;
+       }
+
+       for (size_t j = 0; j < batch.size(); ++j)
+       {
+          const solveJob &job = batch[j];
+          const int n_rows = job.header.n_rows, n_cols = job.header.n_cols;
+          const size_t n_cells = size_t(n_rows) * n_cols;
+
+          const std::pair<int, int> size(n_rows, n_cols);
+
+          if (solvers.count(size) == 0 and int(solvers.size()) >= maxSolvers)
+          {
+             solverMap::iterator oldest = solvers.begin(), i;
+             for (i = solvers.begin(); i != solvers.end(); ++i)
+             {
+                if (i->second.second < oldest->second.second) {oldest = i;}
+             }
+
+             ms_solver_destroy(oldest->second.first);
+             solvers.erase(oldest);
+          }
+
+          std::pair<ms_solver *, uint64_t> &entry = solvers[size];
+          if (entry.first == 0)
+          {
+             entry.first = ms_solver_create(n_rows, n_cols);
+          }
+          entry.second = ++n_jobs;
+
+          const bool withProbs = (job.header.type == requestSolveWithProbs);
+          deductions.assign(n_cells, MS_DEDUCED_NONE);
+          probs.assign(withProbs? n_cells: 0, -1.0);
+
+          // A solver that could not be created is tried again by the next request.
+          serverSolveReplyHeader reply;
+          reply.result =
+          (entry.first == 0)? -MS_ERROR_MEMORY:
+          ms_solve(entry.first, &job.cells[0], &deductions[0], (withProbs? &probs[0]: 0));
+
+          if (entry.first == 0)
+          {
+             solvers.erase(size);
+          }
+
+          const size_t n_probBytes = probs.size() * sizeof(double);
+
+          std::vector<unsigned char> output(sizeof(reply) + n_cells + n_probBytes);
+          std::memcpy(&output[0], &reply, sizeof(reply));
+          std::memcpy(&output[sizeof(reply)], &deductions[0], n_cells);
+          if (withProbs)
+          {
+             std::memcpy(&output[sizeof(reply) + n_cells], &probs[0], n_probBytes);
+          }
+
+          const std::chrono::duration<double, std::micro> latency =
+          steadyClock::now() - job.received;
+
+          std::lock_guard<std::mutex> lock(S.mutex);
+          S.latencies[S.n_latencies++ % S.latencies.size()] = latency.count();
+          ++S.n_solved;
+          S.replies.push_back(std::make_pair(job.fd, std::move(output)));
+          const char c = 0;
+          if (write(S.wakePipe[1], &c, 1) < 0) {} // Pipe full means I/O thread will wake anyway.
+       }
+    }
+
+    solverMap::iterator i;
+    for (i = solvers.begin(); i != solvers.end(); ++i)
+    {
+       ms_solver_destroy(i->second.first);
+    }
+ }
+
+ /*
+  * Read as much of the request from client fd (connection C) as has arrived, without
+  * waiting, and act upon it if it is complete.  Return false if fd should be closed, as it
+  * should on a solve request for a board of more than maxSquares squares (before the cells
+  * are read).  Sets C.busy if the request was queued for a worker.
+  */
+ bool readRequest(serverState &S, const int &fd, clientConnection &C, const size_t &maxSquares)
+ {
+    const size_t headerSize = sizeof(C.header);
+
+    for (;;)
+    {
+       // The request is complete once its cells (if any) have been read.
+       if (C.n_read >= headerSize and C.n_read == headerSize + C.cells.size())
+       {
+          break;
+       }
+
+       char  *to;
+       size_t n;
+
+       if (C.n_read < headerSize)
+       {
+          to = reinterpret_cast<char *>(&C.header) + C.n_read;
+          n  = headerSize - C.n_read;
+       }
+       else
+       {
+          to = reinterpret_cast<char *>(&C.cells[0]) + (C.n_read - headerSize);
+          n  = headerSize + C.cells.size() - C.n_read;
+       }
+
+       const ssize_t got = recv(fd, to, n, MSG_DONTWAIT);
+
+       if (got < 0 and (errno == EAGAIN or errno == EWOULDBLOCK))
+       {
+          return true; // Wait for the rest.
+       }
+
+       if (got <= 0)
+       {
+          return false;
+       }
+
+       C.n_read += got;
+
+       if (C.n_read == headerSize)
+       {
+          const bool solve =
+          (C.header.type == requestSolve or C.header.type == requestSolveWithProbs);
+          const size_t n_cells = size_t(C.header.n_rows) * C.header.n_cols;
+
+          if (solve and (n_cells == 0 or n_cells > maxSquares))
+          {
+             return false;
+          }
+
+          C.cells.resize(solve? n_cells: 0);
+       }
+    }
+
+    C.n_read = 0;
+
+    switch (C.header.type)
+    {
+     case requestSolve:
+     case requestSolveWithProbs:
+       {
+          solveJob job;
+          job.fd       = fd;
+          job.header   = C.header;
+          job.cells.swap(C.cells);
+          job.received = steadyClock::now();
+
+          std::lock_guard<std::mutex> lock(S.mutex);
+          S.jobs.push_back(std::move(job));
+          S.jobsAvailable.notify_one();
+          C.busy = true;
+          return true;
+       }
+     case requestStats:
+       {
+          serverStatsReply stats;
+          getStats(S, stats);
+
+          const unsigned char *p = reinterpret_cast<const unsigned char *>(&stats);
+          C.output.assign(p, p + sizeof(stats));
+          return true;
+       }
+     case requestShutdown:
+       {
+          std::lock_guard<std::mutex> lock(S.mutex);
+          S.stopping = true;
+          S.jobsAvailable.notify_all();
+          return false;
+       }
+    }
+
+    return false; // Unknown request type.
+ }
+
+ /*
+  * Send as much of the reply to client fd (connection C) as the socket takes without
+  * waiting.  Return false if fd should be closed.
+  */
+ bool writeReply(const int &fd, clientConnection &C)
+ {
+    while (C.n_written < C.output.size())
+    {
+       const ssize_t put = send
+       (
+          fd, &C.output[C.n_written], C.output.size() - C.n_written, MSG_DONTWAIT | MSG_NOSIGNAL
+       );
+
+       if (put < 0 and (errno == EAGAIN or errno == EWOULDBLOCK))
+       {
+          return true; // Wait for room.
+       }
+
+       if (put <= 0)
+       {
+          return false;
+       }
+
+       C.n_written += put;
+    }
+
+    std::vector<unsigned char>().swap(C.output); // (Replies may be large.)
+    C.n_written = 0;
+
+    return true;
+ }
+
+ /*
+  * Write a request header.
+  */
+ bool sendHeader(const int &fd, const int &type, const int &n_rows, const int &n_cols)
+ {
+    serverRequestHeader header;
+    header.type   = type;
+    header.n_rows = n_rows;
+    header.n_cols = n_cols;
+    return writeFully(fd, &header, sizeof(header));
+ }
+
+} // End anonymous namespace.
+
+// Function definitions. ///////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ bool runServer(const char *socketPath, const int &n_workers, const long &maxSquares)
+ {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (std::strlen(socketPath) >= sizeof(addr.sun_path))
+    {
+       return false;
+    }
+
+    std::strcpy(addr.sun_path, socketPath);
+
+    const int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+    {
+       return false;
+    }
+
+    unlink(socketPath);
+
+    if
+    (
+       bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 or
+       listen(listenFd, 64) < 0
+    )
+    {
+       close(listenFd);
+       return false;
+    }
+
+    const size_t squaresLimit = std::max(1L, std::min(maxSquares, long(MS_MAX_SQUARES)));
+
+    serverState S;
+    if (pipe(S.wakePipe) < 0)
+    {
+       close(listenFd);
+       return false;
+    }
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < std::max(1, n_workers); ++w)
+    {
+       workers.push_back(std::thread(workerLoop, std::ref(S)));
+    }
+
+    std::map<int, clientConnection> clients; // By fd.
+    std::vector<pollfd> pollFds;
+    bool listening = true;
+
+    for (;;)
+    {
+       bool stopping;
+       int  n_busy = 0, n_sending = 0;
+       std::vector< std::pair< int, std::vector<unsigned char> > > replies;
+       {
+          std::lock_guard<std::mutex> lock(S.mutex);
+          stopping = S.stopping;
+          replies.swap(S.replies);
+       }
+
+       // Start sending the replies from workers.
+       for (size_t i = 0; i < replies.size(); ++i)
+       {
+          const int         fd = replies[i].first;
+          clientConnection &C  = clients[fd];
+
+          C.busy = false;
+          C.output.swap(replies[i].second);
+
+          if (not writeReply(fd, C)) {clients.erase(fd); close(fd);}
+       }
+
+       if (stopping and listening)
+       {
+          close(listenFd);
+          listening = false;
+       }
+
+       pollFds.clear();
+       pollFds.push_back(pollfd());
+       pollFds.back().fd     = S.wakePipe[0];
+       pollFds.back().events = POLLIN;
+
+       if (listening)
+       {
+          pollFds.push_back(pollfd());
+          pollFds.back().fd     = listenFd;
+          pollFds.back().events = POLLIN;
+       }
+
+       // Clients are polled for room to send a reply, or failing that for a request.
+       std::map<int, clientConnection>::iterator c;
+       for (c = clients.begin(); c != clients.end(); ++c)
+       {
+          const bool sending = not c->second.output.empty();
+
+          if (c->second.busy)           {++n_busy; continue;}
+          if (stopping and not sending) {continue;           }
+          n_sending += sending;
+          pollFds.push_back(pollfd());
+          pollFds.back().fd     = c->first;
+          pollFds.back().events = (sending)? POLLOUT: POLLIN;
+       }
+
+       if (stopping and n_busy == 0 and n_sending == 0)
+       {
+          break; // All accepted requests have been answered.
+       }
+
+       // When stopping, clients that take no more of their replies for a while are dropped.
+       const int n_ready = poll(&pollFds[0], pollFds.size(), (stopping)? shutdownWaitMs: -1);
+
+       if (n_ready == 0 and n_busy == 0)
+       {
+          break;
+       }
+
+       if (n_ready < 0)
+       {
+          continue; // Interrupted.
+       }
+
+       for (size_t i = 0; i < pollFds.size(); ++i)
+       {
+          if (pollFds[i].revents == 0)
+          {
+             continue;
+          }
+
+          const int fd = pollFds[i].fd;
+
+          if (fd == S.wakePipe[0])
+          {
+             char buf[256];
+             if (read(fd, buf, sizeof(buf)) < 0) {}
+          }
+          else if (listening and fd == listenFd)
+          {
+             const int clientFd = accept(listenFd, 0, 0);
+             if (clientFd >= 0) {clients[clientFd] = clientConnection();}
+          }
+          else
+          {
+             clientConnection &C = clients[fd];
+
+             const bool open =
+             (C.output.empty())? readRequest(S, fd, C, squaresLimit) and writeReply(fd, C):
+                                 writeReply(fd, C);
+
+             if (not open)
+             {
+                clients.erase(fd);
+                close(fd);
+             }
+          }
+       }
+    }
+
+    for (size_t w = 0; w < workers.size(); ++w)
+    {
+       workers[w].join();
+    }
+
+    std::map<int, clientConnection>::iterator c;
+    for (c = clients.begin(); c != clients.end(); ++c)
+    {
+       close(c->first);
+    }
+
+    close(S.wakePipe[0]);
+    close(S.wakePipe[1]);
+    unlink(socketPath);
+
+    return true;
+ }
+
+ /*
+  *
+  */
+ int connectToServer(const char *socketPath)
+ {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (std::strlen(socketPath) >= sizeof(addr.sun_path))
+    {
+       return -1;
+    }
+
+    std::strcpy(addr.sun_path, socketPath);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+       return -1;
+    }
+
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+       close(fd);
+       return -1;
+    }
+
+    return fd;
+ }
+
+ /*
+  *
+  */
+ bool serverSolve
+ (
+    const int &fd, const int &n_rows, const int &n_cols, const unsigned char *cells,
+    int &result, unsigned char *deductions, double *probs
+ )
+ {
+    const size_t n_cells = size_t(n_rows) * n_cols;
+    const int    type    = (probs == 0)? requestSolve: requestSolveWithProbs;
+
+    serverSolveReplyHeader reply;
+
+    if
+    (
+       not sendHeader(fd, type, n_rows, n_cols)     or
+       not writeFully(fd, cells, n_cells)           or
+       not readFully(fd, &reply, sizeof(reply))     or
+       not readFully(fd, deductions, n_cells)       or
+       (probs != 0 and not readFully(fd, probs, n_cells * sizeof(double)))
+    )
+    {
+       return false;
+    }
+
+    result = reply.result;
+    return true;
+ }
+
+ /*
+  *
+  */
+ bool serverStats(const int &fd, serverStatsReply &stats)
+ {
+    return sendHeader(fd, requestStats, 0, 0) and readFully(fd, &stats, sizeof(stats));
+ }
+
+ /*
+  *
+  */
+ bool serverShutdown(const int &fd)
+ {
+    return sendHeader(fd, requestShutdown, 0, 0);
+ }
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,95 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "server.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Solver daemon listening on a Unix domain socket, and the matching client functions.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+
+// Protocol definitions. ///////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Requests and replies are in native byte order (the socket is local).
+  *
+  * Request:  serverRequestHeader, then for solve requests n_rows * n_cols cell bytes
+  *           (encoded as for ms_solve() in "libminesweeper.h").
+  * Reply to solve requests:
+  *           serverSolveReplyHeader, then n_rows * n_cols deduction bytes, then
+  *           (for requestSolveWithProbs only) n_rows * n_cols doubles.
+  * Reply to requestStats:
+  *           serverStatsReply.
+  * requestShutdown has no reply.  The server finishes queued requests then exits.
+  */
+ enum serverRequestType
+ {
+    requestSolve          = 1,
+    requestSolveWithProbs = 2,
+    requestStats          = 3,
+    requestShutdown       = 4
+ };
+
+ struct serverRequestHeader
+ {
+    uint32_t type;   // serverRequestType.
+    uint16_t n_rows;
+    uint16_t n_cols;
+ };
+
+ struct serverSolveReplyHeader
+ {
+    int32_t result; // As returned by ms_solve().
+ };
+
+ struct serverStatsReply
+ {
+    uint64_t n_solved;    // Number of solve requests completed since startup.
+    uint64_t n_batches;   // Number of batches taken by workers.
+    double   latencyP50;  // Latency percentiles in microseconds (time from request
+    double   latencyP90;  //   received to reply ready to send) over the most recent solves.
+    double   latencyP99;
+    double   latencyMax;
+ };
+
+ // Function declarations. //////////////////////////////////////////////////////////////////////
+
+ /*
+  * Listen on socketPath and serve requests using n_workers solver threads until a
+  * shutdown request is received.  Connections sending solve requests for boards of more
+  * than maxSquares squares (or MS_MAX_SQUARES, if less) are closed before the cells are
+  * read.  Returns false if the socket could not be set up.
+  */
+ bool runServer(const char *socketPath, const int &n_workers, const long &maxSquares = 1 << 20);
+
+ /* Connect to the server at socketPath.  Returns a socket descriptor, or -1 on failure. */
+ int connectToServer(const char *socketPath);
+
+ /* Send a request and read its reply (if any).  Return false on failure. */
+ bool serverSolve
+ (
+    const int &fd, const int &n_rows, const int &n_cols, const unsigned char *cells,
+    int &result, unsigned char *deductions, double *probs
+ );
+ bool serverStats(const int &fd, serverStatsReply &stats);
+ bool serverShutdown(const int &fd);
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
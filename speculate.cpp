@@ -0,0 +1,331 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "speculate.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Function definitions for class template "speculativeSolver".
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "speculate.h"
+
+#include <cassert>
+
+// Public function definitions. ////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ template<class Field>
+ void speculativeSolver<Field>::start(const Field &M, const basicMineFieldProbMap<Field> &P)
+ {
+    stop();
+
+    outcomes.clear();
+    next       = square(0, 0);
+    n_recorded = 0;
+    finished   = (maxCandidates == 0);
+
+    if (finished)
+    {
+       return;
+    }
+
+    baseP.reset();
+    baseM.reset(new Field(M));
+    baseP.reset(new basicMineFieldProbMap<Field>(baseM.get()));
+    baseP->copyState(P);
+    baseP->setVerbose(false);
+
+    resume();
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ void speculativeSolver<Field>::resume(void)
+ {
+    if (not finished and not thread.joinable())
+    {
+       cancelFlag = false;
+       thread     = std::thread(&speculativeSolver::solveCandidates, this);
+    }
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ void speculativeSolver<Field>::stop(void)
+ {
+    if (thread.joinable())
+    {
+       cancelFlag = true;
+       thread.join();
+    }
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ std::size_t speculativeSolver<Field>::memoryUsage(memoryReport &report) const
+ {
+    assert(not thread.joinable());
+
+    std::size_t total = 0;
+
+    if (baseM) {total += baseM->memoryUsage(report) + baseP->memoryUsage(report);}
+
+    std::size_t bytes = heapBytes(outcomes);
+
+    for (const std::unique_ptr<outcome> &o: outcomes)
+    {
+       bytes += sizeof(outcome) + heapBytes(o->rounds) + heapBytes(o->delta.probs);
+
+       for (const round &r: o->rounds)
+       {
+          bytes += heapBytes(r.explored) + heapBytes(r.flagged);
+       }
+    }
+
+    report.add("speculation outcomes", bytes);
+
+    return total + bytes;
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ std::size_t speculativeSolver<Field>::estimateMemoryUsage
+ (
+    const int &h, const int &w, const int &n, const int &maxCandidates
+ )
+ {
+    if (maxCandidates == 0)
+    {
+       return 0;
+    }
+
+    const std::size_t squares = std::size_t(h) * w;
+    const std::size_t change  = sizeof(std::pair<square, double>);
+
+    const std::size_t game =
+    Field::estimateMemoryUsage(h, w, n) + basicMineFieldProbMap<Field>::estimateMemoryUsage(h, w);
+
+    // Each square changes at most about once in the minefield's journal (row, column and old
+    // value) and the solver's while a candidate is solved, and once in the outcomes.
+    const std::size_t journals = squares * (sizeof(square) + sizeof(int) + change);
+
+    return
+    (
+       game + journals + squares * change +
+       maxCandidates * (sizeof(outcome) + sizeof(std::unique_ptr<outcome>))
+    );
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ const typename speculativeSolver<Field>::outcome *
+ speculativeSolver<Field>::find(const square &s) const
+ {
+    assert(not thread.joinable());
+
+    for (const std::unique_ptr<outcome> &o: outcomes)
+    {
+       if (o->s == s)
+       {
+          return o.get();
+       }
+    }
+
+    return 0;
+ }
+
+} // End namespace minesweeper.
+
+// Private function definitions. ///////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Thread function.  Solve candidates from next until all are solved, the outcomes reach
+  * their limits or the thread is cancelled (in which case next is the candidate to resume
+  * from).
+  */
+ template<class Field>
+ void speculativeSolver<Field>::solveCandidates(void)
+ {
+    const Field                        &M = *baseM;
+    const basicMineFieldProbMap<Field> &P = *baseP;
+
+    const std::size_t maxRecorded = std::size_t(M.getHeight()) * M.getWidth();
+
+    square n;
+
+    for (; next.row < M.getHeight(); ++next.row, next.col = 0)
+    {
+       for (; next.col < M.getWidth(); ++next.col)
+       {
+          const square &s = next;
+
+          if (cancelFlag)
+          {
+             return;
+          }
+
+          if (int(outcomes.size()) == maxCandidates)
+          {
+             finished = true;
+             return;
+          }
+
+          if (M.squareExplored(s) or M.squareFlagged(s) or P.squareKnown(s))
+          {
+             continue;
+          }
+
+          bool onFrontier = false;
+          for (n.row = s.row - 1; n.row <= s.row + 1 and not onFrontier; ++n.row)
+          {
+             for (n.col = s.col - 1; n.col <= s.col + 1 and not onFrontier; ++n.col)
+             {
+                onFrontier = M.squareInsideMap(n) and M.squareExplored(n);
+             }
+          }
+
+          if (onFrontier)
+          {
+             std::unique_ptr<outcome> o(new outcome(s));
+
+             if (not solve(*o))
+             {
+                if (cancelFlag) {return;} // (Solved again on resume().)
+                continue;
+             }
+
+             if (n_recorded + squaresRecorded(*o) > maxRecorded)
+             {
+                finished = true;
+                return;
+             }
+
+             n_recorded += squaresRecorded(*o);
+             outcomes.push_back(std::move(o));
+          }
+       }
+    }
+
+    finished = true;
+ }
+
+ /*
+  * Explore o.s then explore automatically as autoExplore() does, recording each round and the
+  * solver's changes, under snapshots of the base minefield and solver that are popped after.
+  * Return false if o.s is mined or the thread was cancelled.
+  */
+ template<class Field>
+ bool speculativeSolver<Field>::solve(outcome &o)
+ {
+    Field                        &M = *baseM;
+    basicMineFieldProbMap<Field> &P = *baseP;
+
+    M.pushSnapshot();
+    P.pushSnapshot();
+
+    bool solved = M.explore(o.s);
+
+    while (solved)
+    {
+       bool changed;
+
+       if (P.update(&cancelFlag, &changed) != updateComplete)
+       {
+          solved = false;
+          break;
+       }
+
+       if (not changed)
+       {
+          break;
+       }
+
+       o.rounds.push_back(round());
+       round &r = o.rounds.back();
+
+       square s;
+       for (s.row = 0; s.row < M.getHeight(); ++s.row)
+       {
+          for (s.col = 0; s.col < M.getWidth(); ++s.col)
+          {
+             if (P.squareClear(s) and not M.squareExplored(s))
+             {
+                M.explore(s);
+                r.explored.push_back(s);
+             }
+             else if (P.squareMined(s) and not M.squareFlagged(s))
+             {
+                M.flagSquare(s);
+                r.flagged.push_back(s);
+             }
+          }
+       }
+
+       if (M.gameWon())
+       {
+          break;
+       }
+    }
+
+    P.popSnapshot(solved? &o.delta: 0);
+    M.popSnapshot();
+
+    return solved;
+ }
+
+ /*
+  *
+  */
+ template<class Field>
+ std::size_t speculativeSolver<Field>::squaresRecorded(const outcome &o)
+ {
+    std::size_t n = o.delta.probs.size();
+
+    for (const round &r: o.rounds)
+    {
+       n += r.explored.size() + r.flagged.size();
+    }
+
+    return n;
+ }
+
+} // End namespace minesweeper.
+
+// Explicit instantiations. ////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ template class speculativeSolver<mineField>;
+ template class speculativeSolver< mineFieldT< 8,  8> >;
+ template class speculativeSolver< mineFieldT<16, 16> >;
+ template class speculativeSolver< mineFieldT<16, 30> >;
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
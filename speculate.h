@@ -0,0 +1,138 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "speculate.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Background solving of candidate moves while an interactive game waits for input.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef SPECULATE_H
+#define SPECULATE_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "minefield.h"
+#include "mineprob.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Class definition. ///////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * While the player is choosing a square, works out on a background thread what exploring
+  * each of a number of candidate squares would lead to, so that the result can be committed
+  * as soon as the player chooses one of them instead of being solved from scratch.
+  *
+  * Candidates are the unexplored squares not known to the solver that neighbour explored
+  * squares (the squares a player is most likely to choose), in row major order.  Each is
+  * solved as autoExplore() in "main.cpp" would solve it: rounds of update() followed by
+  * exploring squares found clear and flagging squares found mined, until update() learns
+  * nothing or the game is won.  All candidates are solved on one copy of the minefield and
+  * solver, under snapshots that are popped after each, so only the squares of each round
+  * and the solver's changes are kept.  These are limited in total to one board's worth of
+  * squares; candidates beyond the limit are not solved.
+  */
+ template<class Field>
+ class speculativeSolver
+ {
+  public:
+    /* Squares explored and flagged by one round of automatic exploration, in order. */
+    class round
+    {
+     public:
+       std::vector<square> explored, flagged;
+    };
+
+    /* Result of exploring square s (which was clear). */
+    class outcome
+    {
+     public:
+       outcome(const square &_s) : s(_s) {}
+
+       square                                               s;
+       std::vector<round>                                   rounds;
+       typename basicMineFieldProbMap<Field>::snapshotDelta delta; // Solver changes in all
+                                                                    // rounds.
+    };
+
+    speculativeSolver(const int &_maxCandidates = 64) // (0 to solve nothing in advance)
+    : maxCandidates(_maxCandidates), cancelFlag(false), finished(true)
+    {}
+
+    ~speculativeSolver(void) {stop();}
+
+    /*
+     * Start solving candidate moves for M using P (which must be up to date) on a background
+     * thread, discarding any previous results.  M and P are copied, so may be used freely.
+     */
+    void start(const Field &M, const basicMineFieldProbMap<Field> &P);
+
+    /*
+     * Continue solving the candidates of the last start() if stopped before all were solved.
+     * The minefield and solver given to start() must not have changed since.
+     */
+    void resume(void);
+
+    /* Stop the background thread, keeping the outcomes solved so far. */
+    void stop(void);
+
+    /* Return the outcome of exploring s if it has been solved (only valid after stop()). */
+    const outcome *find(const square &s) const;
+
+    /* Add the bytes used by the copy of the game and outcomes to report (after stop()). */
+    std::size_t memoryUsage(memoryReport &report) const;
+
+    /*
+     * Return an estimate of the most memory a speculativeSolver with maxCandidates candidates
+     * uses for games of the given size (the copy of the game, its snapshot journals and the
+     * outcomes, which are limited to one board's worth of squares).
+     */
+    static std::size_t estimateMemoryUsage
+    (
+       const int &h, const int &w, const int &n, const int &maxCandidates
+    );
+
+  private:
+    void solveCandidates(void);
+    bool solve(outcome &o);
+
+    /* Return the number of squares recorded in o. */
+    static std::size_t squaresRecorded(const outcome &o);
+
+    const int maxCandidates;
+
+    std::unique_ptr<Field>                        baseM; // State to solve candidates from.
+    std::unique_ptr< basicMineFieldProbMap<Field> > baseP;
+
+    std::vector< std::unique_ptr<outcome> > outcomes;   // Written only by the thread.
+    square                                  next;       // Next square to consider as a
+                                                        // candidate.
+    std::size_t                             n_recorded; // Squares recorded in outcomes.
+
+    std::atomic<bool> cancelFlag;
+    bool              finished; // All candidates have been considered.
+    std::thread       thread;
+ };
+
+ extern template class speculativeSolver<mineField>;
+ extern template class speculativeSolver< mineFieldT< 8,  8> >;
+ extern template class speculativeSolver< mineFieldT<16, 16> >;
+ extern template class speculativeSolver< mineFieldT<16, 30> >;
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,534 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "tournament.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Tournaments of automated games split into shards played by separate processes.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "tournament.h"
+#include "driver.h"
+#include "leb128.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// File-scope definitions. /////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ const char shardMagic[8] = {'M', 'S', 'S', 'H', 'A', 'R', 'D', '1'};
+
+ /*
+  * Contents of the shared memory segment of a tournament: one slot per process, holding the
+  * totals of its shard.  A new segment is zero filled, which is a valid initial state for
+  * the (lock free) atomics.  Slots are claimed and released only while holding a lock on the
+  * segment (see openShared()), but are read and added to without it.
+  */
+ class sharedSlot
+ {
+  public:
+    enum {unused = 0, finished = -1}; // Values of pid other than that of a playing process.
+
+    std::atomic<int>  pid;
+    std::atomic<long> n_games, n_won, n_guesses;
+ };
+
+ class sharedTotals
+ {
+  public:
+    enum {maxProcesses = 256};
+
+    sharedSlot slots[maxProcesses];
+ };
+
+ static_assert(std::atomic<long>::is_always_lock_free and std::atomic<int>::is_always_lock_free);
+
+ /*
+  * The segment attached by this process.  File scope so that the signal handler can reach it.
+  */
+ class sharedAttachment
+ {
+  public:
+    sharedTotals *totals;
+    sharedSlot   *slot;
+    int           fd;       // Kept open for locking.
+    char          name[128];
+ };
+
+ sharedAttachment attached;
+
+ /* Test whether the process with this pid is still running (kill() only checks). */
+ bool processAlive(const int &pid)
+ {
+    return pid > 0 and (kill(pid, 0) == 0 or errno == EPERM);
+ }
+
+ /*
+  * Test whether slot is counted: processes that finished their shard are, and so are those
+  * still playing, but not those that died without releasing their slot.
+  */
+ bool slotCounted(const sharedSlot &slot)
+ {
+    const int pid = slot.pid;
+
+    return pid == sharedSlot::finished or processAlive(pid);
+ }
+
+ bool anyPlaying(const sharedTotals &totals)
+ {
+    for (const sharedSlot &slot: totals.slots)
+    {
+       if (processAlive(slot.pid)) {return true;}
+    }
+
+    return false;
+ }
+
+ /*
+  * Map the shared memory segment of the tournament, creating it if need be, and claim a slot
+  * for this process.  If no process is playing, the slots of earlier runs are cleared first.
+  * Return false if shared memory is unavailable or every slot is taken.
+  *
+  * The segment is locked (with flock()) while slots are claimed or released, and the last
+  * process to release a slot removes the segment while holding the lock.  A process that
+  * opened the segment just before it was removed finds it has no links once it has the lock,
+  * and opens again.
+  */
+ bool openShared(const char *name)
+ {
+    int         fd;
+    struct stat status;
+
+    for (;;)
+    {
+       fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+
+       if (fd < 0)
+       {
+          return false;
+       }
+
+       if (flock(fd, LOCK_EX) != 0 or fstat(fd, &status) != 0)
+       {
+          close(fd);
+          return false;
+       }
+
+       if (status.st_nlink > 0)
+       {
+          break;
+       }
+
+       close(fd); // Removed while waiting for the lock.
+    }
+
+    void *p = MAP_FAILED;
+
+    if (status.st_size == sizeof(sharedTotals) or ftruncate(fd, sizeof(sharedTotals)) == 0)
+    {
+       p = mmap(0, sizeof(sharedTotals), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    if (p == MAP_FAILED)
+    {
+       close(fd);
+       return false;
+    }
+
+    sharedTotals *totals = static_cast<sharedTotals *>(p);
+    sharedSlot   *slot   = 0;
+
+    if (not anyPlaying(*totals))
+    {
+       for (sharedSlot &s: totals->slots)
+       {
+          s.pid = sharedSlot::unused;
+       }
+    }
+
+    for (sharedSlot &s: totals->slots)
+    {
+       if (s.pid != sharedSlot::finished and not processAlive(s.pid))
+       {
+          slot = &s;
+          break;
+       }
+    }
+
+    if (slot != 0)
+    {
+       slot->n_games   = 0;
+       slot->n_won     = 0;
+       slot->n_guesses = 0;
+       slot->pid       = getpid();
+    }
+
+    flock(fd, LOCK_UN);
+
+    if (slot == 0)
+    {
+       munmap(p, sizeof(sharedTotals));
+       close(fd);
+       return false;
+    }
+
+    attached.totals = totals;
+    attached.slot   = slot;
+    attached.fd     = fd;
+    snprintf(attached.name, sizeof(attached.name), "%s", name);
+
+    return true;
+ }
+
+ /*
+  * Release the slot of this process, marking it finished (so still counted) or free, and
+  * remove the segment if no process is still playing.  Only async-signal-safe functions are
+  * used (flock() and shm_unlink() are single system calls on Linux), so that the signal
+  * handler can call this.
+  */
+ void releaseSlot(const int &state)
+ {
+    flock(attached.fd, LOCK_EX);
+
+    attached.slot->pid = state;
+
+    if (not anyPlaying(*attached.totals))
+    {
+       shm_unlink(attached.name);
+    }
+
+    flock(attached.fd, LOCK_UN);
+ }
+
+ /* Release the slot of this process, having finished its shard, and unmap the segment. */
+ void closeShared(void)
+ {
+    releaseSlot(sharedSlot::finished);
+
+    munmap(attached.totals, sizeof(sharedTotals));
+    close(attached.fd);
+
+    attached.totals = 0;
+ }
+
+ /*
+  * Release the slot of the interrupted shard (its games are not counted) then let the
+  * signal take its usual course.
+  */
+ void onSignal(int signalNumber)
+ {
+    releaseSlot(sharedSlot::unused);
+
+    signal(signalNumber, SIG_DFL);
+    raise(signalNumber);
+ }
+
+ /* Return the totals of the counted slots. */
+ tournamentTotals sumShared(const sharedTotals &totals)
+ {
+    tournamentTotals sum;
+
+    for (const sharedSlot &slot: totals.slots)
+    {
+       if (slotCounted(slot))
+       {
+          sum.n_games   += slot.n_games;
+          sum.n_won     += slot.n_won;
+          sum.n_guesses += slot.n_guesses;
+       }
+    }
+
+    return sum;
+ }
+
+ /*
+  * A block record of a shard file.
+  */
+ class shardBlock
+ {
+  public:
+    bool operator<(const shardBlock &b) const {return firstSeed < b.firstSeed;}
+
+    unsigned long long firstSeed;
+    tournamentTotals   totals;
+ };
+
+ /*
+  * Read the shard file at path, checking that it is of the tournament described by header
+  * (or setting header if it is empty), and append its blocks to blocks.
+  */
+ bool readShard
+ (
+    const char *path, std::vector<unsigned long long> &header, std::vector<shardBlock> &blocks
+ )
+ {
+    FILE *file = fopen(path, "rb");
+
+    if (file == 0)
+    {
+       return false;
+    }
+
+    std::vector<unsigned char> data;
+    unsigned char              block[1 << 16];
+    size_t                     n;
+
+    while ((n = fread(block, 1, sizeof(block), file)) > 0)
+    {
+       data.insert(data.end(), block, block + n);
+    }
+
+    fclose(file);
+
+    if (data.size() < sizeof(shardMagic) or memcmp(&data[0], shardMagic, sizeof(shardMagic)))
+    {
+       return false;
+    }
+
+    size_t pos = sizeof(shardMagic);
+
+    // The tournament (the shard number and count may differ between files).
+    std::vector<unsigned long long> h(7);
+
+    for (int i = 0; i < 7; ++i)
+    {
+       if (not getNumber(data, pos, h[i]))
+       {
+          return false;
+       }
+    }
+
+    if (header.empty())
+    {
+       header = h;
+    }
+    else if (not std::equal(h.begin(), h.begin() + 5, header.begin()))
+    {
+       return false;
+    }
+
+    while (pos < data.size())
+    {
+       unsigned long long seed, games, won, guesses;
+
+       if
+       (
+          not getNumber(data, pos, seed) or not getNumber(data, pos, games) or
+          not getNumber(data, pos, won)  or not getNumber(data, pos, guesses)
+       )
+       {
+          return false;
+       }
+
+       shardBlock b;
+       b.firstSeed        = seed;
+       b.totals.n_games   = games;
+       b.totals.n_won     = won;
+       b.totals.n_guesses = guesses;
+       blocks.push_back(b);
+    }
+
+    return true;
+ }
+}
+
+// Public function definitions. ////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * The shard is played in blocks of games by runBatch(), so that the file and the shared
+  * totals are brought up to date as it goes.
+  */
+ bool runShard
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const int &shard, const int &n_shards,
+    const int &n_threads, const char *path, tournamentTotals &shardTotals,
+    const std::function<void (const tournamentTotals &, const tournamentTotals &)> &progress
+ )
+ {
+    FILE *file = fopen(path, "wb");
+
+    if (file == 0)
+    {
+       return false;
+    }
+
+    std::vector<unsigned char> buffer(shardMagic, shardMagic + sizeof(shardMagic));
+
+    putNumber(buffer, n_rows);
+    putNumber(buffer, n_cols);
+    putNumber(buffer, n_mines);
+    putNumber(buffer, firstSeed);
+    putNumber(buffer, n_games);
+    putNumber(buffer, shard);
+    putNumber(buffer, n_shards);
+
+    bool written = fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+
+    char name[128];
+    snprintf
+    (
+       name, sizeof(name), "/minesweeper_text-%dx%d-%d-%u-%d", n_rows, n_cols, n_mines,
+       firstSeed, n_games
+    );
+
+    // While attached, SIGINT and SIGTERM release this process's slot before ending it.
+    const bool shared = openShared(name);
+
+    struct sigaction action, oldInt, oldTerm;
+
+    if (shared)
+    {
+       memset(&action, 0, sizeof(action));
+       action.sa_handler = onSignal;
+       sigemptyset(&action.sa_mask);
+
+       sigaction(SIGINT,  &action, &oldInt);
+       sigaction(SIGTERM, &action, &oldTerm);
+    }
+
+    const long begin      = long(shard)     * n_games / n_shards;
+    const long end        = long(shard + 1) * n_games / n_shards;
+    const long blockGames = 256L * std::max(1, n_threads);
+
+    for (long g = begin; g < end and written; g += blockGames)
+    {
+       const int      n    = int(std::min(blockGames, end - g));
+       const unsigned seed = firstSeed + unsigned(g);
+
+       const batchResult r = runBatch(n_rows, n_cols, n_mines, n, seed, n_threads);
+
+       buffer.clear();
+       putNumber(buffer, seed);
+       putNumber(buffer, r.n_games);
+       putNumber(buffer, r.n_won);
+       putNumber(buffer, r.n_guesses);
+
+       written = fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+       written = (fflush(file) == 0) and written;
+
+       shardTotals.n_games   += r.n_games;
+       shardTotals.n_won     += r.n_won;
+       shardTotals.n_guesses += r.n_guesses;
+
+       tournamentTotals local = shardTotals;
+
+       if (shared)
+       {
+          attached.slot->n_games   += r.n_games;
+          attached.slot->n_won     += r.n_won;
+          attached.slot->n_guesses += r.n_guesses;
+
+          local = sumShared(*attached.totals);
+       }
+
+       if (progress)
+       {
+          progress(shardTotals, local);
+       }
+    }
+
+    if (shared)
+    {
+       // Signals arriving while detaching are held until the handlers are restored.
+       sigset_t signals, oldSignals;
+
+       sigemptyset(&signals);
+       sigaddset(&signals, SIGINT);
+       sigaddset(&signals, SIGTERM);
+       pthread_sigmask(SIG_BLOCK, &signals, &oldSignals);
+
+       closeShared();
+
+       sigaction(SIGINT,  &oldInt,  0);
+       sigaction(SIGTERM, &oldTerm, 0);
+       pthread_sigmask(SIG_SETMASK, &oldSignals, 0);
+    }
+
+    return (fclose(file) == 0) and written;
+ }
+
+ /*
+  *
+  */
+ bool mergeShards(const std::vector<const char *> &paths, mergeResult &result)
+ {
+    std::vector<unsigned long long> header;
+    std::vector<shardBlock>         blocks;
+
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+       if (not readShard(paths[i], header, blocks))
+       {
+          return false;
+       }
+    }
+
+    if (header.empty())
+    {
+       return false;
+    }
+
+    result.n_rows    = header[0];
+    result.n_cols    = header[1];
+    result.n_mines   = header[2];
+    result.firstSeed = header[3];
+    result.n_games   = header[4];
+    result.totals    = tournamentTotals();
+
+    std::sort(blocks.begin(), blocks.end());
+
+    // Blocks must lie in the tournament's seeds without overlapping.
+    const unsigned long long last = header[3] + header[4]; // One past the last seed.
+    unsigned long long       next = header[3];
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+       const shardBlock &b = blocks[i];
+
+       if (b.firstSeed < next or b.firstSeed + b.totals.n_games > last)
+       {
+          return false;
+       }
+
+       next = b.firstSeed + b.totals.n_games;
+
+       result.totals.n_games   += b.totals.n_games;
+       result.totals.n_won     += b.totals.n_won;
+       result.totals.n_guesses += b.totals.n_guesses;
+    }
+
+    result.n_missing = result.n_games - result.totals.n_games;
+
+    return true;
+ }
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,106 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "tournament.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Tournaments of automated games split into shards played by separate processes.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include <functional>
+#include <vector>
+
+// Shard file format. //////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * A tournament is n_games automated games (as in --batch) with seeds firstSeed to
+  * firstSeed + n_games - 1.  Shard i of n_shards plays the games from i * n_games / n_shards
+  * up to (i + 1) * n_games / n_shards, so shards may be run by any processes on any hosts.
+  *
+  * A shard file is the 8 byte magic number "MSSHARD1", then the numbers
+  *
+  *    n_rows  n_cols  n_mines  firstSeed  n_games  shard  n_shards
+  *
+  * then one record per block of games played, appended as each block completes:
+  *
+  *    blockFirstSeed  blockGames  won  guesses
+  *
+  * each unsigned LEB128 as in trace files.  A shard that is stopped early leaves a file of
+  * the blocks it completed.
+  */
+
+ // Class definitions. //////////////////////////////////////////////////////////////////////////
+
+ /*
+  * Totals of games played.
+  */
+ class tournamentTotals
+ {
+  public:
+    tournamentTotals(void) : n_games(0), n_won(0), n_guesses(0) {}
+
+    long n_games, n_won, n_guesses;
+ };
+
+ /*
+  * Totals for mergeShards().
+  */
+ class mergeResult
+ {
+  public:
+    mergeResult(void)
+    : n_rows(0), n_cols(0), n_mines(0), firstSeed(0), n_games(0), n_missing(0) {}
+
+    int              n_rows, n_cols, n_mines;
+    unsigned         firstSeed;
+    long             n_games;   // Games in the tournament.
+    long             n_missing; // Games in the tournament not in any shard file.
+    tournamentTotals totals;
+ };
+
+ // Function declarations. //////////////////////////////////////////////////////////////////////
+
+ /*
+  * Play shard shard of n_shards of the tournament (using n_threads threads) and write its
+  * shard file at path.  While playing, the totals of every process on this host playing a
+  * shard of the same tournament are kept in a POSIX shared memory segment (named after the
+  * tournament), one slot per process.  Shards that finished are counted until no process
+  * is playing, when the segment is removed.  Shards interrupted by SIGINT or SIGTERM, or
+  * whose process has died, are not counted.  After each block of games,
+  * progress(shardTotals, localTotals) is called if given.  Return false if the file could
+  * not be written.
+  */
+ bool runShard
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const int &shard, const int &n_shards,
+    const int &n_threads, const char *path, tournamentTotals &shardTotals,
+    const std::function<void (const tournamentTotals &, const tournamentTotals &)> &progress
+    = 0
+ );
+
+ /*
+  * Combine the shard files at paths into the totals of their tournament.  Return false if
+  * any file cannot be read, the files are of different tournaments or any game is in more
+  * than one block.  The totals do not depend on how the tournament was sharded.
+  */
+ bool mergeShards(const std::vector<const char *> &paths, mergeResult &result);
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,275 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "trace.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Recording of games to binary trace files, and replay of trace files.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "trace.h"
+#include "mineprob.h"
+#include "leb128.h"
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+// File-scope definitions. /////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ const char traceMagic[8] = {'M', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+
+ /*
+  * Cursor over a trace held in memory.
+  */
+ class traceReader
+ {
+  public:
+    traceReader(const std::vector<unsigned char> &_data) : data(_data), pos(0), failed(false) {}
+
+    bool atEnd(void) const {return pos >= data.size();}
+    bool ok(void)    const {return not failed;}
+
+    unsigned char getByte(void)
+    {
+       if (atEnd()) {failed = true; return 0;}
+       return data[pos++];
+    }
+
+    unsigned getNumber(void)
+    {
+       unsigned long long n;
+
+       if (not minesweeper::getNumber(data, pos, n) or n > UINT_MAX)
+       {
+          failed = true;
+          return 0;
+       }
+
+       return unsigned(n);
+    }
+
+    square getSquare(void) {const int r = getNumber(); return square(r, getNumber());}
+
+  private:
+    const std::vector<unsigned char> &data;
+    size_t pos;
+    bool   failed;
+ };
+
+ /*
+  * Re-execute the records of a trace on a minefield of type Field.
+  */
+ template<class Field>
+ bool replayRecords
+ (
+    traceReader &in, const int &n_rows, const int &n_cols, const int &n_mines,
+    traceReplayResult &result
+ )
+ {
+    Field                        M(n_rows, n_cols, n_mines);
+    basicMineFieldProbMap<Field> P(&M);
+
+    P.setVerbose(false);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    bool inGame = false;
+
+    while (not in.atEnd() and in.ok())
+    {
+       const unsigned char type = in.getByte();
+
+       if (type != traceNewGame and not inGame)
+       {
+          return false;
+       }
+
+       switch (type)
+       {
+        case traceNewGame:
+          M.reset(in.getNumber());
+          P.reset();
+          inGame = true;
+          ++result.n_games;
+          break;
+
+        case traceExplore:
+        case traceFlag:
+          {
+             const square s = in.getSquare();
+
+             if (not in.ok() or not M.squareInsideMap(s))
+             {
+                return false;
+             }
+
+             if (type == traceExplore) {M.explore(s);   }
+             else                      {M.flagSquare(s);}
+
+             ++result.n_actions;
+          }
+          break;
+
+        case traceUpdate:
+          {
+             const bool changed = in.getByte();
+
+             result.n_mismatches += (P.update() != changed);
+             ++result.n_updates;
+          }
+          break;
+
+        default:
+          return false;
+       }
+    }
+
+    result.seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return in.ok();
+ }
+}
+
+// Public function definitions. ////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ bool traceWriter::open
+ (
+    const char *path, const int &n_rows, const int &n_cols, const int &n_mines
+ )
+ {
+    close();
+
+    file = fopen(path, "wb");
+
+    if (file == 0)
+    {
+       return false;
+    }
+
+    buffer.reserve(blockSize);
+    buffer.assign(traceMagic, traceMagic + sizeof(traceMagic));
+    putNumber(n_rows);
+    putNumber(n_cols);
+    putNumber(n_mines);
+
+    return true;
+ }
+
+ /*
+  *
+  */
+ void traceWriter::close(void)
+ {
+    if (file != 0)
+    {
+       flush();
+       fclose(file);
+       file = 0;
+    }
+ }
+
+ /*
+  *
+  */
+ bool replayTrace(const char *path, traceReplayResult &result)
+ {
+    FILE *file = fopen(path, "rb");
+
+    if (file == 0)
+    {
+       return false;
+    }
+
+    // Read the whole trace first so that replay does no I/O.
+    std::vector<unsigned char> data;
+    unsigned char              block[1 << 16];
+    size_t                     n;
+
+    while ((n = fread(block, 1, sizeof(block), file)) > 0)
+    {
+       data.insert(data.end(), block, block + n);
+    }
+
+    fclose(file);
+
+    if (data.size() < sizeof(traceMagic) or memcmp(&data[0], traceMagic, sizeof(traceMagic)))
+    {
+       return false;
+    }
+
+    traceReader in(data);
+
+    for (size_t i = 0; i < sizeof(traceMagic); ++i)
+    {
+       in.getByte();
+    }
+
+    const int n_rows = in.getNumber(), n_cols = in.getNumber(), n_mines = in.getNumber();
+
+    if (not in.ok() or n_rows <= 0 or n_cols <= 0 or n_mines >= n_rows * n_cols)
+    {
+       return false;
+    }
+
+    return dispatchFieldType
+    (
+       n_rows, n_cols,
+       [&](auto ft)
+       {
+          return replayRecords<typename decltype(ft)::type>(in, n_rows, n_cols, n_mines, result);
+       }
+    );
+ }
+
+} // End namespace minesweeper.
+
+// Private function definitions. ///////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  *
+  */
+ void traceWriter::putNumber(unsigned n)
+ {
+    minesweeper::putNumber(buffer, n);
+
+    if (buffer.size() >= blockSize) {flush();}
+ }
+
+ /*
+  *
+  */
+ void traceWriter::flush(void)
+ {
+    if (file != 0 and not buffer.empty())
+    {
+       fwrite(&buffer[0], 1, buffer.size(), file);
+    }
+
+    buffer.clear();
+ }
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
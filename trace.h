@@ -0,0 +1,106 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "trace.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Recording of games to binary trace files, and replay of trace files.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "minefield.h"
+
+#include <vector>
+
+#include <cstdio>
+
+// Trace format. ///////////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * A trace file is the 8 byte magic number "MSTRACE1", then the number of rows, columns and
+  * mines, then a sequence of records.  Each record is a one byte traceRecordType followed by
+  * its operands.  Numbers are unsigned LEB128 (7 bits per byte, least significant first).
+  *
+  *    traceNewGame  seed       minefield reset(seed) and solver reset()
+  *    traceExplore  row col    explore(square(row, col)) (by the player or the solver)
+  *    traceFlag     row col    flagSquare(square(row, col))
+  *    traceUpdate   changed    solver update() (changed is its result, 0 or 1)
+  */
+ enum traceRecordType
+ {
+    traceNewGame = 1,
+    traceExplore = 2,
+    traceFlag    = 3,
+    traceUpdate  = 4
+ };
+
+ /*
+  * Buffered appender for trace files.  Records are written to the file in blocks.
+  */
+ class traceWriter
+ {
+  public:
+    traceWriter(void) : file(0) {}
+    ~traceWriter(void) {close();}
+
+    /* Create the trace file and write its header.  Return false on failure. */
+    bool open(const char *path, const int &n_rows, const int &n_cols, const int &n_mines);
+    void close(void);
+
+    void newGame(const unsigned &seed) {put(traceNewGame); putNumber(seed);}
+    void explore(const square &s) {put(traceExplore); putNumber(s.row); putNumber(s.col);}
+    void flag(const square &s)    {put(traceFlag);    putNumber(s.row); putNumber(s.col);}
+    void update(const bool &changed) {put(traceUpdate); put(changed);}
+
+  private:
+    enum {blockSize = 1 << 16};
+
+    void put(const unsigned char &b)
+    {buffer.push_back(b); if (buffer.size() >= blockSize) {flush();}}
+    void putNumber(unsigned n);
+    void flush(void);
+
+    FILE                      *file;
+    std::vector<unsigned char> buffer;
+ };
+
+ /*
+  * Totals for replayTrace().
+  */
+ class traceReplayResult
+ {
+  public:
+    traceReplayResult(void)
+    : n_games(0), n_actions(0), n_updates(0), n_mismatches(0), seconds(0.0)
+    {}
+
+    long   n_games, n_actions, n_updates;
+    long   n_mismatches; // Updates whose result differed from that recorded.
+    double seconds;      // Time taken to replay (excluding reading the file).
+ };
+
+ // Function declarations. //////////////////////////////////////////////////////////////////////
+
+ /*
+  * Read the trace file at path into memory and re-execute it, with the solver's progress
+  * messages off.  Return false if the file could not be read or is not a valid trace.
+  */
+ bool replayTrace(const char *path, traceReplayResult &result);
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/
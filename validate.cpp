@@ -0,0 +1,763 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "validate.cpp"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Differential validation of solver engines against the reference solver.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include "validate.h"
+#include "driver.h"
+#include "libminesweeper.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
+#include <cmath>
+
+// File-scope definitions. /////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+ using namespace minesweeper;
+
+ typedef std::chrono::steady_clock steadyClock;
+
+ typedef std::vector<unsigned char> byteVector;
+
+ double secondsSince(const steadyClock::time_point &start)
+ {
+    return std::chrono::duration<double>(steadyClock::now() - start).count();
+ }
+
+ /*
+  * Encode the visible state of M as for ms_solve().  Flags are left unexplored as the
+  * solvers ignore them.
+  */
+ template<class Field>
+ void getCells(const Field &M, byteVector &cells)
+ {
+    square s;
+
+    for (s.row = 0; s.row < M.getHeight(); ++s.row)
+    {
+       for (s.col = 0; s.col < M.getWidth(); ++s.col)
+       {
+          cells[s.row * M.getWidth() + s.col] =
+          (M.squareExplored(s))? M.n_minedNbours(s): MS_CELL_UNKNOWN;
+       }
+    }
+ }
+
+ /*
+  * Encode the deductions of P (a solver for M) as for ms_solve().
+  */
+ template<class Field>
+ void getDeductions(const Field &M, const basicMineFieldProbMap<Field> &P, byteVector &d)
+ {
+    square s;
+
+    for (s.row = 0; s.row < M.getHeight(); ++s.row)
+    {
+       for (s.col = 0; s.col < M.getWidth(); ++s.col)
+       {
+          d[s.row * M.getWidth() + s.col] =
+          (P.squareClear(s))? MS_DEDUCED_CLEAR: (P.squareMined(s))? MS_DEDUCED_MINED:
+                                                                   MS_DEDUCED_NONE;
+       }
+    }
+ }
+
+ /*
+  * Solve a board given as cells (used as the reference for cropped boards).
+  */
+ void solveCells(const int &n_rows, const int &n_cols, const byteVector &cells, byteVector &d)
+ {
+    ms_solver *solver = ms_solver_create(n_rows, n_cols);
+    ms_solve(solver, &cells[0], &d[0], 0);
+    ms_solver_destroy(solver);
+ }
+
+ const char *deductionName(const unsigned char &d)
+ {
+    switch (d)
+    {
+     case MS_DEDUCED_CLEAR: return "clear";
+     case MS_DEDUCED_MINED: return "mined";
+    }
+
+    return "unknown";
+ }
+
+ /*
+  * True if the reference and candidate deductions for a square (of which truth is the
+  * correct deduction) disagree or either is wrong.
+  */
+ bool mismatch(const unsigned char &ref, const unsigned char &cand, const unsigned char &truth)
+ {
+    return
+    (
+       ref != cand or
+       (ref  != MS_DEDUCED_NONE and ref  != truth) or
+       (cand != MS_DEDUCED_NONE and cand != truth)
+    );
+ }
+
+ // Candidate engines. ------------------------------------------------------------------------//
+
+ /*
+  * Each candidate solves the position of the reference minefield M (also given as cells),
+  * writing deductions as for ms_solve() and returning the time spent solving.
+  * solveCrop() solves an arbitrary board given as cells, returning false if the engine
+  * cannot.  addTotals() adds any totals particular to the engine to those of a share.
+  * Squares deduced by the candidate but not the reference are reported as mismatches unless
+  * deducesMore is true.
+  */
+ template<class Field>
+ class fixedSizeCandidate
+ {
+  public:
+    fixedSizeCandidate(const int &n_rows, const int &n_cols, const int &n_mines)
+    : F(n_rows, n_cols, n_mines), P(&F)
+    {P.setVerbose(false);}
+
+    double solve(const mineField &M, const byteVector &, byteVector &d)
+    {
+       F.reset(M.getSeed());
+
+       for (const square &s: M.getRevealLog())
+       {
+          F.explore(s);
+       }
+
+       const steadyClock::time_point start = steadyClock::now();
+       P.reset();
+       P.update();
+       const double seconds = secondsSince(start);
+
+       getDeductions(F, P, d);
+       return seconds;
+    }
+
+    bool solveCrop(const int &, const int &, const byteVector &, byteVector &) {return false;}
+
+    void addTotals(validateResult &) const {}
+
+    static const bool deducesMore = false;
+
+  private:
+    Field                        F;
+    basicMineFieldProbMap<Field> P;
+ };
+
+ class libraryCandidate
+ {
+  public:
+    libraryCandidate(const int &n_rows, const int &n_cols, const int &)
+    : solver(ms_solver_create(n_rows, n_cols))
+    {}
+
+    ~libraryCandidate(void) {ms_solver_destroy(solver);}
+
+    double solve(const mineField &, const byteVector &cells, byteVector &d)
+    {
+       const steadyClock::time_point start = steadyClock::now();
+       ms_solve(solver, &cells[0], &d[0], 0);
+       return secondsSince(start);
+    }
+
+    bool solveCrop(const int &n_rows, const int &n_cols, const byteVector &cells, byteVector &d)
+    {
+       solveCells(n_rows, n_cols, cells, d);
+       return true;
+    }
+
+    void addTotals(validateResult &) const {}
+
+    static const bool deducesMore = false;
+
+  private:
+    libraryCandidate(const libraryCandidate &);
+
+    ms_solver *solver;
+ };
+
+ /*
+  * Deduces squares given probability zero or one by updateProbabilities() and compares the
+  * probabilities with those found by bruteForceProbabilities() where the frontier is small.
+  */
+ class probabilityCandidate
+ {
+  public:
+    probabilityCandidate(const int &n_rows, const int &n_cols, const int &_n_mines)
+    : F(n_rows, n_cols, _n_mines), P(&F), n_mines(_n_mines),
+      n_probPositions(0), n_probWrong(0), maxProbError(0.0)
+    {P.setVerbose(false);}
+
+    double solve(const mineField &M, const byteVector &, byteVector &d);
+
+    bool solveCrop(const int &, const int &, const byteVector &, byteVector &) {return false;}
+
+    void addTotals(validateResult &share) const
+    {
+       share.n_probPositions += n_probPositions;
+       share.n_probWrong     += n_probWrong;
+       share.maxProbError     = std::max(share.maxProbError, maxProbError);
+    }
+
+    static const bool deducesMore = true;
+
+  private:
+    bool bruteForceProbabilities(std::vector<double> &probs) const;
+
+    mineField        F;
+    mineFieldProbMap P;
+    const int        n_mines;
+
+    long   n_probPositions, n_probWrong;
+    double maxProbError;
+ };
+
+ /*
+  *
+  */
+ double probabilityCandidate::solve(const mineField &M, const byteVector &, byteVector &d)
+ {
+    F.reset(M.getSeed());
+
+    for (const square &s: M.getRevealLog())
+    {
+       F.explore(s);
+    }
+
+    const steadyClock::time_point start = steadyClock::now();
+    P.reset();
+    P.update();
+    P.updateProbabilities(n_mines);
+    const double seconds = secondsSince(start);
+
+    getDeductions(F, P, d);
+
+    std::vector<double> probs;
+
+    if (bruteForceProbabilities(probs))
+    {
+       square s;
+
+       for (s.row = 0; s.row < F.getHeight(); ++s.row)
+       {
+          for (s.col = 0; s.col < F.getWidth(); ++s.col)
+          {
+             const double expected = probs[s.row * F.getWidth() + s.col];
+
+             if (expected >= 0.0)
+             {
+                const double error = std::fabs(P.getProbMined(s) - expected);
+
+                maxProbError = std::max(maxProbError, error);
+                n_probWrong += (error > 1e-9);
+             }
+          }
+       }
+
+       ++n_probPositions;
+    }
+
+    return seconds;
+ }
+
+ /*
+  * Set probs to the probability of each unexplored square of F being mined (-1.0 for explored
+  * squares), found by trying every assignment of mines to the unexplored squares next to
+  * explored squares and weighting each consistent assignment by the number of ways of placing
+  * the remaining mines among the other unexplored squares.  Return false (leaving probs
+  * unset) if there are more than maxBruteForceFrontier squares to assign.
+  */
+ bool probabilityCandidate::bruteForceProbabilities(std::vector<double> &probs) const
+ {
+    const int H = F.getHeight(), W = F.getWidth();
+
+    std::vector<square>   cells;       // Unexplored squares next to explored squares.
+    std::vector<unsigned> masks;       // For each explored square, its cells (as bits) ...
+    std::vector<int>      counts;      // ... and the number of them mined.
+    std::vector<int>      cellIndex(H * W, -1);
+    int                   n_interior = 0;
+
+    square s, t;
+
+    for (s.row = 0; s.row < H; ++s.row)
+    {
+       for (s.col = 0; s.col < W; ++s.col)
+       {
+          if (F.squareExplored(s))
+          {
+             continue;
+          }
+
+          bool onFrontier = false;
+
+          for (t.row = s.row - 1; t.row <= s.row + 1; ++t.row)
+          {
+             for (t.col = s.col - 1; t.col <= s.col + 1; ++t.col)
+             {
+                onFrontier = onFrontier or (F.squareInsideMap(t) and F.squareExplored(t));
+             }
+          }
+
+          if (not onFrontier)
+          {
+             ++n_interior;
+          }
+          else if (int(cells.size()) == maxBruteForceFrontier)
+          {
+             return false;
+          }
+          else
+          {
+             cellIndex[s.row * W + s.col] = int(cells.size());
+             cells.push_back(s);
+          }
+       }
+    }
+
+    for (s.row = 0; s.row < H; ++s.row)
+    {
+       for (s.col = 0; s.col < W; ++s.col)
+       {
+          if (not F.squareExplored(s))
+          {
+             continue;
+          }
+
+          unsigned mask = 0;
+
+          for (t.row = s.row - 1; t.row <= s.row + 1; ++t.row)
+          {
+             for (t.col = s.col - 1; t.col <= s.col + 1; ++t.col)
+             {
+                if (F.squareInsideMap(t) and cellIndex[t.row * W + t.col] != -1)
+                {
+                   mask |= 1u << cellIndex[t.row * W + t.col];
+                }
+             }
+          }
+
+          masks.push_back(mask);
+          counts.push_back(F.n_minedNbours(s));
+       }
+    }
+
+    // Weights of assignments with k cells mined, relative to the largest (to avoid overflow).
+    const int n = int(cells.size());
+    std::vector<double> logWays(n + 1, -1.0), weight(n + 1, 0.0);
+    double maxLogWays = -1.0;
+
+    for (int k = 0; k <= n; ++k)
+    {
+       const int rest = n_mines - k;
+
+       if (0 <= rest and rest <= n_interior)
+       {
+          logWays[k] =
+          std::lgamma(n_interior + 1.0) - std::lgamma(rest + 1.0) -
+          std::lgamma(n_interior - rest + 1.0);
+
+          maxLogWays = std::max(maxLogWays, logWays[k]);
+       }
+    }
+
+    for (int k = 0; k <= n; ++k)
+    {
+       if (logWays[k] >= 0.0) {weight[k] = std::exp(logWays[k] - maxLogWays);}
+    }
+
+    std::vector<double> minedWeight(n, 0.0);
+    double total = 0.0, interiorMines = 0.0;
+
+    for (unsigned a = 0; a < (1u << n); ++a)
+    {
+       const int k = std::popcount(a);
+       bool consistent = (weight[k] > 0.0);
+
+       for (size_t i = 0; consistent and i < masks.size(); ++i)
+       {
+          consistent = (std::popcount(a & masks[i]) == counts[i]);
+       }
+
+       if (consistent)
+       {
+          total         += weight[k];
+          interiorMines += weight[k] * (n_mines - k);
+
+          for (int i = 0; i < n; ++i)
+          {
+             if (a & (1u << i)) {minedWeight[i] += weight[k];}
+          }
+       }
+    }
+
+    probs.assign(H * W, -1.0);
+
+    for (s.row = 0; s.row < H; ++s.row)
+    {
+       for (s.col = 0; s.col < W; ++s.col)
+       {
+          const int i = cellIndex[s.row * W + s.col];
+          double   &p = probs[s.row * W + s.col];
+
+          if      (i != -1)                 {p = minedWeight[i] / total;               }
+          else if (not F.squareExplored(s)) {p = interiorMines / total / n_interior;}
+       }
+    }
+
+    return true;
+ }
+
+ // Mismatch reports. -------------------------------------------------------------------------//
+
+ /*
+  * Copy the rectangle (r0, c0) to (r1, c1) of the board cells (n_cols wide).  Explored
+  * squares on the edge of the rectangle with neighbours outside it are made unknown, as
+  * their mine counts include squares that are no longer on the board.
+  */
+ void cropCells
+ (
+    const byteVector &cells, const int &n_rows, const int &n_cols,
+    const int &r0, const int &c0, const int &r1, const int &c1, byteVector &crop
+ )
+ {
+    const int w = c1 - c0 + 1;
+
+    crop.resize((r1 - r0 + 1) * w);
+
+    for (int r = r0; r <= r1; ++r)
+    {
+       for (int c = c0; c <= c1; ++c)
+       {
+          const bool cut =
+          (r == r0 and r > 0) or (r == r1 and r < n_rows - 1) or
+          (c == c0 and c > 0) or (c == c1 and c < n_cols - 1);
+
+          const unsigned char v = cells[r * n_cols + c];
+
+          crop[(r - r0) * w + c - c0] = (cut and v <= 8)? MS_CELL_UNKNOWN: v;
+       }
+    }
+ }
+
+ /*
+  * Describe the mismatch at square x of the position of M, cropping the board while the
+  * mismatch persists.
+  */
+ template<class Candidate>
+ std::string describeMismatch
+ (
+    const mineField &M, const byteVector &cells, const square &x,
+    const unsigned char &ref, const unsigned char &cand, Candidate &C
+ )
+ {
+    const int H = M.getHeight(), W = M.getWidth();
+    const unsigned char truth = (M.squareHidesMine(x))? MS_DEDUCED_MINED: MS_DEDUCED_CLEAR;
+
+    int r0 = 0, c0 = 0, r1 = H - 1, c1 = W - 1;
+
+    byteVector crop, refD, candD;
+
+    // Test whether the mismatch persists on a crop.
+    auto persists = [&](const int &_r0, const int &_c0, const int &_r1, const int &_c1)
+    {
+       const int h = _r1 - _r0 + 1, w = _c1 - _c0 + 1, i = (x.row - _r0) * w + x.col - _c0;
+
+       cropCells(cells, H, W, _r0, _c0, _r1, _c1, crop);
+       refD.resize(crop.size());
+       candD.resize(crop.size());
+
+       solveCells(h, w, crop, refD);
+
+       return C.solveCrop(h, w, crop, candD) and mismatch(refD[i], candD[i], truth);
+    };
+
+    std::ostringstream out;
+
+    out << "Seed " << M.getSeed() << ", " << M.getRevealLog().size() << " squares explored: "
+        << "square " << x << " reference " << deductionName(ref)
+        << ", candidate " << deductionName(cand)
+        << ", actually " << deductionName(truth) << "." << std::endl;
+
+    if (persists(r0, c0, r1, c1))
+    {
+       for (bool shrunk = true; shrunk;)
+       {
+          shrunk = false;
+
+          if (r0 < x.row and persists(r0 + 1, c0, r1, c1)) {++r0; shrunk = true;}
+          if (c0 < x.col and persists(r0, c0 + 1, r1, c1)) {++c0; shrunk = true;}
+          if (r1 > x.row and persists(r0, c0, r1 - 1, c1)) {--r1; shrunk = true;}
+          if (c1 > x.col and persists(r0, c0, r1, c1 - 1)) {--c1; shrunk = true;}
+       }
+    }
+    else
+    {
+       out << "(Not reproducible on a board given as cells; whole board shown.)" << std::endl;
+    }
+
+    out << "Rows " << r0 << "-" << r1 << ", cols " << c0 << "-" << c1
+        << " ('?' marks the square):" << std::endl;
+
+    cropCells(cells, H, W, r0, c0, r1, c1, crop);
+
+    for (int r = r0; r <= r1; ++r)
+    {
+       for (int c = c0; c <= c1; ++c)
+       {
+          const unsigned char v = crop[(r - r0) * (c1 - c0 + 1) + c - c0];
+
+          out << ((square(r, c) == x)? '?': (v <= 8)? char('0' + v): '-') << ' ';
+       }
+
+       out << std::endl;
+    }
+
+    return out.str();
+ }
+
+ // Validation. -------------------------------------------------------------------------------//
+
+ /*
+  * Run a share of the validation on one thread (see runValidation()).
+  */
+ template<class Candidate>
+ void validateShare
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const unsigned &seedStep,
+    const int &maxReports, std::mutex &resultMutex, validateResult &result
+ )
+ {
+    mineField        M(n_rows, n_cols, n_mines);
+    mineFieldProbMap P(&M);
+    Candidate        C(n_rows, n_cols, n_mines);
+
+    P.setVerbose(false);
+
+    const int n = n_rows * n_cols;
+    byteVector cells(n), refD(n), candD(n);
+
+    validateResult share;
+
+    for (int g = 0; g < n_games; ++g)
+    {
+       const unsigned seed = firstSeed + g * seedStep;
+       std::minstd_rand rng(seed);
+
+       M.reset(seed);
+
+       bool alive = M.explore(square(n_rows / 2, n_cols / 2));
+
+       while (alive and not M.gameWon())
+       {
+          getCells(M, cells);
+
+          const steadyClock::time_point start = steadyClock::now();
+          P.reset();
+          P.update();
+          share.refSeconds += secondsSince(start);
+
+          getDeductions(M, P, refD);
+          share.candSeconds += C.solve(M, cells, candD);
+
+          ++share.n_positions;
+
+          square s;
+          bool reported = false;
+
+          for (s.row = 0; s.row < n_rows; ++s.row)
+          {
+             for (s.col = 0; s.col < n_cols; ++s.col)
+             {
+                const int i = s.row * n_cols + s.col;
+
+                if (M.squareExplored(s))
+                {
+                   continue;
+                }
+
+                const unsigned char truth =
+                (M.squareHidesMine(s))? MS_DEDUCED_MINED: MS_DEDUCED_CLEAR;
+
+                share.n_refDeductions  += (refD[i]  != MS_DEDUCED_NONE);
+                share.n_candDeductions += (candD[i] != MS_DEDUCED_NONE);
+                share.n_refWrong  += (refD[i]  != MS_DEDUCED_NONE and refD[i]  != truth);
+                share.n_candWrong += (candD[i] != MS_DEDUCED_NONE and candD[i] != truth);
+                share.n_missing   += (refD[i]  != MS_DEDUCED_NONE and candD[i] == MS_DEDUCED_NONE);
+                share.n_extra     += (candD[i] != MS_DEDUCED_NONE and refD[i]  == MS_DEDUCED_NONE);
+
+                const bool expected =
+                (Candidate::deducesMore and refD[i] == MS_DEDUCED_NONE and candD[i] == truth);
+
+                // Report the first mismatch of each position.
+                if
+                (
+                   not reported and int(share.reports.size()) < maxReports and
+                   mismatch(refD[i], candD[i], truth) and not expected
+                )
+                {
+                   share.reports.push_back(describeMismatch(M, cells, s, refD[i], candD[i], C));
+                   reported = true;
+                }
+             }
+          }
+
+          // Move on: explore every square the reference found clear, or guess.
+          bool progressed = false;
+
+          for (s.row = 0; s.row < n_rows; ++s.row)
+          {
+             for (s.col = 0; s.col < n_cols; ++s.col)
+             {
+                if (P.squareClear(s) and not M.squareExplored(s))
+                {
+                   M.explore(s);
+                   progressed = true;
+                }
+             }
+          }
+
+          if (not progressed)
+          {
+             alive = M.explore(chooseSquare(M, P, decideGuess, rng));
+          }
+       }
+    }
+
+    C.addTotals(share);
+
+    std::lock_guard<std::mutex> lock(resultMutex);
+
+    result.n_positions      += share.n_positions;
+    result.n_refDeductions  += share.n_refDeductions;
+    result.n_candDeductions += share.n_candDeductions;
+    result.n_refWrong       += share.n_refWrong;
+    result.n_candWrong      += share.n_candWrong;
+    result.n_missing        += share.n_missing;
+    result.n_extra          += share.n_extra;
+    result.refSeconds       += share.refSeconds;
+    result.candSeconds      += share.candSeconds;
+    result.n_probPositions  += share.n_probPositions;
+    result.n_probWrong      += share.n_probWrong;
+    result.maxProbError      = std::max(result.maxProbError, share.maxProbError);
+
+    for (size_t i = 0; i < share.reports.size() and int(result.reports.size()) < maxReports; ++i)
+    {
+       result.reports.push_back(share.reports[i]);
+    }
+ }
+
+ /*
+  *
+  */
+ template<class Candidate>
+ validateResult runValidationT
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const int &n_threads, const int &maxReports
+ )
+ {
+    validateResult result;
+    std::mutex     resultMutex;
+
+    // Thread t plays seeds firstSeed + t, firstSeed + t + n_threads, ...
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t)
+    {
+       const int n_share = (n_games - t + n_threads - 1) / n_threads;
+
+       threads.push_back
+       (
+          std::thread
+          (
+             validateShare<Candidate>, n_rows, n_cols, n_mines, n_share, firstSeed + t,
+             unsigned(n_threads), maxReports, std::ref(resultMutex), std::ref(result)
+          )
+       );
+    }
+
+    for (size_t t = 0; t < threads.size(); ++t)
+    {
+       threads[t].join();
+    }
+
+    return result;
+ }
+
+} // End anonymous namespace.
+
+// Function definitions. ///////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * For validateFixedSize on dimensions with no fixed-size type no positions are validated.
+  */
+ validateResult runValidation
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const int &n_threads,
+    const validateEngine &engine, const int &maxReports
+ )
+ {
+    if (engine == validateLibrary)
+    {
+       return runValidationT<libraryCandidate>
+       (
+          n_rows, n_cols, n_mines, n_games, firstSeed, n_threads, maxReports
+       );
+    }
+
+    if (engine == validateProbabilities)
+    {
+       return runValidationT<probabilityCandidate>
+       (
+          n_rows, n_cols, n_mines, n_games, firstSeed, n_threads, maxReports
+       );
+    }
+
+    return dispatchFieldType
+    (
+       n_rows, n_cols,
+       [&](auto ft)
+       {
+          typedef typename decltype(ft)::type Field;
+
+          if constexpr (std::is_same<Field, mineField>::value)
+          {
+             return validateResult();
+          }
+          else
+          {
+             return runValidationT< fixedSizeCandidate<Field> >
+             (
+                n_rows, n_cols, n_mines, n_games, firstSeed, n_threads, maxReports
+             );
+          }
+       }
+    );
+ }
+
+} // End namespace minesweeper.
+
+/*******************************************END*OF*FILE********************************************/
@@ -0,0 +1,102 @@
+/**************************************************************************************************\
+*
+* vim: ts=3 sw=3 et wrap co=100 go-=b
+*
+* Filename: "validate.h"
+*
+* Project: Minesweeper Text
+*
+* Purpose: Differential validation of solver engines against the reference solver.
+*
+* Author: Tom McDonnell 2003
+*
+\**************************************************************************************************/
+
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+// Includes. ///////////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+// Class definitions. //////////////////////////////////////////////////////////////////////////////
+
+namespace minesweeper
+{
+
+ /*
+  * Engines that may be validated against the reference solver (mineFieldProbMap).
+  */
+ enum validateEngine
+ {
+    validateFixedSize,    // mineFieldProbMapT<H, W> (only for dimensions with a fixed-size type).
+    validateLibrary,      // ms_solve() from "libminesweeper.h" (basicMineFieldProbMap<boardView>).
+    validateProbabilities // updateProbabilities() (also checked against brute force, see below).
+ };
+
+ /*
+  * Totals for runValidation().  Deductions are counted over unexplored squares only.
+  */
+ class validateResult
+ {
+  public:
+    validateResult(void)
+    : n_positions(0), n_refDeductions(0), n_candDeductions(0),
+      n_refWrong(0), n_candWrong(0), n_missing(0), n_extra(0),
+      refSeconds(0.0), candSeconds(0.0),
+      n_probPositions(0), n_probWrong(0), maxProbError(0.0)
+    {}
+
+    long n_positions;
+    long n_refDeductions, n_candDeductions;
+    long n_refWrong, n_candWrong; // Deductions contradicting the hidden mine map.
+    long n_missing;               // Squares deduced by the reference but not the candidate.
+    long n_extra;                 // Squares deduced by the candidate but not the reference.
+
+    double refSeconds, candSeconds; // Time spent solving (summed over threads).
+
+    // For validateProbabilities only.
+    long   n_probPositions; // Positions whose probabilities were checked by brute force.
+    long   n_probWrong;     // Squares whose probability differed from that by brute force.
+    double maxProbError;    // Largest difference found.
+
+    std::vector<std::string> reports; // Descriptions of mismatches, with minimised boards.
+ };
+
+ // Constants. //////////////////////////////////////////////////////////////////////////////////
+
+ const int maxBruteForceFrontier = 16;
+
+ // Function declarations. //////////////////////////////////////////////////////////////////////
+
+ /*
+  * Play n_games automated games with seeds firstSeed to firstSeed + n_games - 1 using the
+  * reference solver, split between n_threads (at least 1) threads.  After each move, solve
+  * the position from scratch with both the reference solver and the candidate engine, check
+  * every deduction of each against the hidden mine map and compare the two sets of
+  * deductions.
+  *
+  * Up to maxReports mismatches are described in the result.  Each has the smallest
+  * rectangle of the board, found by cropping, on which the mismatch still occurs when both
+  * engines are given just that rectangle (engines that cannot solve arbitrary boards are
+  * reported with the whole board).
+  *
+  * The validateProbabilities engine deduces what updateProbabilities() finds to have
+  * probability zero or one, which may be more than the reference finds (such squares are
+  * counted but not reported).  On positions with at most maxBruteForceFrontier unknown
+  * squares next to explored squares, the probability of every unknown square is also
+  * compared with that found by counting every assignment of mines to those squares.
+  */
+ validateResult runValidation
+ (
+    const int &n_rows, const int &n_cols, const int &n_mines,
+    const int &n_games, const unsigned &firstSeed, const int &n_threads,
+    const validateEngine &engine, const int &maxReports = 5
+ );
+
+} // End namespace minesweeper.
+
+#endif
+
+/*******************************************END*OF*FILE********************************************/